@@ -0,0 +1,89 @@
+// Benchmark for config ingestion (mapping, lexing and parsing) on large generated configs
+// Usage: config-parser-bench [lines] [iterations]
+
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "config/parser.hpp"
+
+// Generates a config of roughly the requested number of lines, mixing
+// every construct the parser handles
+std::string generate_config(size_t lines) {
+    std::string text;
+    size_t line = 0;
+    size_t i = 0;
+
+    while(line < lines) {
+        text += "# host " + std::to_string(i) + " generated section\n";
+        text += "set mod" + std::to_string(i) + " super\n";
+        text += "exec_always \"some-daemon --instance " + std::to_string(i) + "\" --flag\n";
+        text += "output DP-" + std::to_string(i) + " {\n";
+        text += "    mode 3840x2160@143.998Hz\n";
+        text += "    position " + std::to_string(i * 3840) + " 0\n";
+        text += "    transform normal\n";
+        text += "    scale 1.5\n";
+        text += "    adaptive_sync on # trailing comment\n";
+        text += "}\n";
+        text += "bind {\n";
+        for(int key = 0; key < 10; key++)
+            text += "    $mod" + std::to_string(i) + "+" + std::to_string(key) + " workspace " +
+                    std::to_string(key) + "\n";
+        text += "    $mod" + std::to_string(i) + "+Return exec foot --title \"term " +
+                std::to_string(i) + "\"\n";
+        text += "}\n\n";
+
+        line += 25;
+        i++;
+    }
+
+    return text;
+}
+
+template <typename F>
+double time_per_iteration(size_t iterations, F f) {
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < iterations; i++) f();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    size_t lines = argc > 1 ? strtoul(argv[1], nullptr, 10) : 5000;
+    size_t iterations = argc > 2 ? strtoul(argv[2], nullptr, 10) : 200;
+
+    std::string text = generate_config(lines);
+
+    char path[] = "/tmp/dwc-bench-XXXXXX";
+    int fd = mkstemp(path);
+    if(fd < 0 || write(fd, text.data(), text.size()) != (ssize_t)text.size()) {
+        perror("failed writing generated config");
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    size_t statements = 0;
+
+    double parse_us = time_per_iteration(iterations, [&] {
+        parsing::Parser parser(text);
+        parser.parse();
+        statements = parser.statements.size();
+    });
+
+    double file_us = time_per_iteration(iterations, [&] {
+        parsing::MappedFile file(path);
+        parsing::Parser parser(file.text());
+        parser.parse();
+    });
+
+    unlink(path);
+
+    double mb = text.size() / (1024.0 * 1024.0);
+    printf("config: %zu lines, %zu bytes, %zu statements\n", lines, text.size(), statements);
+    printf("parse (in memory):   %10.1f us/iter  %8.1f MiB/s\n", parse_us, mb / (parse_us / 1e6));
+    printf("parse (mapped file): %10.1f us/iter  %8.1f MiB/s\n", file_us, mb / (file_us / 1e6));
+}
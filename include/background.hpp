@@ -0,0 +1,18 @@
+#pragma once
+
+#include "wlr.hpp"
+
+namespace output {
+    class Output;
+}
+
+// Built-in output backgrounds (background in the config), instead of a swaybg per session
+// Solid colors are scene rects, images are decoded by a worker and rendered once per
+// resolution into a GPU buffer that every output showing them at that resolution shares
+namespace background {
+    // Replaces the background of the output with its background_config
+    // Images that aren't rendered at the output's resolution yet show up once decoded
+    void update(output::Output* output);
+    // Called when the output is destroyed
+    void remove(output::Output* output);
+}
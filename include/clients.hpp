@@ -0,0 +1,96 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+#include "wlr-wrapper.hpp"
+#include "wlr.hpp"
+
+// Resource accounting for every Wayland client, to find the ones dragging the
+// compositor down. Offenders are logged, and can be throttled by holding back
+// their frame done events (client_limit in the config)
+namespace clients {
+    // Called for every surface created through wl_compositor
+    void new_surface(wl_listener* listener, void* data);
+
+    class Surface;
+
+    class Client {
+        friend void client_destroy(wl_listener*, void*);
+        friend bool send_frame_done(wlr_surface*, uint64_t);
+        friend int frame_timeout(void*);
+
+        public:
+        wl_client* client;
+        pid_t pid;
+
+        uint64_t commits;
+        // Commits during the last full second
+        uint32_t commit_rate;
+        // Size of the buffers currently attached to its surfaces
+        uint64_t buffer_bytes;
+        // Size of every buffer ever attached
+        uint64_t attached_bytes;
+        uint64_t shm_buffers;
+        uint64_t dmabuf_buffers;
+        // Damaged shm pixels the renderer had to copy to textures
+        uint64_t upload_bytes;
+        uint64_t frame_callbacks;
+        // Frame done events are limited to client_limit commit_rate per second
+        bool throttled;
+
+        std::list<Surface*> surfaces;
+
+        Client(wl_client* client);
+        ~Client();
+
+        // Configures sent to its xdg and layer surfaces that weren't acked yet
+        uint32_t outstanding_configures();
+        void record_commit(uint64_t now);
+        // Compares the statistics with the limits, logging the changes
+        void check_limits();
+
+        private:
+        uint64_t window_start;
+        uint32_t window_commits;
+        uint64_t last_frame_done;
+        // Schedules a frame for the next allowed frame done, so a throttled client waiting
+        // on one doesn't depend on something else damaging its outputs
+        // Created the first time a frame done is held back
+        wl_event_source* frame_timer;
+        bool frame_timer_armed;
+        // Already logged, so an offender isn't logged on every commit
+        bool over_commit_rate;
+        bool over_buffer_bytes;
+
+        wl_listener destroy;
+    };
+
+    class Surface {
+        friend void surface_commit(wl_listener*, void*);
+        friend void surface_destroy(wl_listener*, void*);
+
+        public:
+        wlr_surface* surface;
+        // Null once the client is gone, its surfaces are destroyed after it
+        Client* client;
+
+        Surface(wlr_surface* surface);
+        ~Surface();
+
+        private:
+        uint64_t buffer_bytes;
+
+        wrapper::Listener<Surface> commit;
+        wrapper::Listener<Surface> destroy;
+    };
+
+    extern std::unordered_map<wl_client*, Client*> clients;
+
+    // Whether the surface gets its frame done event now
+    // Called for every surface of an output frame, with the same time
+    bool send_frame_done(wlr_surface* surface, uint64_t now);
+}
@@ -1,26 +1,69 @@
 #pragma once
 
+#include <cstdint>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 #include "util.hpp"
 
+namespace config {
+    class Config;
+    enum class XwaylandMode;
+    enum class BackgroundMode;
+}
+
 namespace commands {
+    // Arguments of a command, pointing into the parsed config text
+    using Args = std::span<const std::string_view>;
+
     enum class CommandType {
         SET,
         ENV,
         EXEC,
         EXEC_ALWAYS,
         OUTPUT,
+        HEADLESS_OUTPUT,
         BIND,
         TERMINATE,
         RELOAD,
         KILL,
         WORKSPACE,
         FULLSCREEN,
-        DEBUG
+        DEBUG,
+        WATCHDOG_BUDGET,
+        CLIENT_LIMIT,
+        FOCUS_BOOST,
+        XWAYLAND
+    };
+
+    // Flat table of config variables
+    // Names are resolved to slots once, so expanding a variable is just an index
+    class VarTable {
+        public:
+        // Changes whenever a value in the table changes
+        uint64_t generation;
+        // Changes whenever the slots are invalidated
+        // Both counters are unique across all tables
+        uint64_t epoch;
+
+        VarTable();
+
+        // Returns the slot of a variable, creating an empty one if it isn't set
+        size_t slot(const std::string& name);
+        const std::string& get(size_t slot) const;
+        // Sets a variable, only bumping the generation if the value actually changed
+        void set(const std::string& name, std::string value);
+        // Number of variables with a different value in the other table
+        size_t count_changes(const VarTable& other) const;
+        void clear();
+
+        private:
+        std::unordered_map<std::string, size_t> slots;
+        std::vector<std::string> values;
     };
 
     // A string that may contain variables that have to be substituted
@@ -29,12 +72,32 @@ namespace commands {
     // Variables that are not set will be replaced with an empty string
     class ParsableContent {
         public:
-        std::string str(std::unordered_map<std::string, std::string>& envs);
+        // The expansion is cached until a variable in the table changes
+        const std::string& str(VarTable& vars);
 
         ParsableContent(std::string content);
 
         private:
+        // Slot of literal segments
+        static constexpr size_t LITERAL = SIZE_MAX;
+
+        // A literal substring of the content, or a variable slot
+        struct Segment {
+            size_t offset;
+            size_t length;
+            size_t slot;
+        };
+
         std::string content;
+
+        std::vector<Segment> segments;
+        uint64_t compiled_epoch;
+
+        std::string expanded;
+        uint64_t expanded_generation;
+
+        // Splits the content into segments, resolving variable names to slots
+        void compile(VarTable& vars);
     };
 
     struct Command {
@@ -46,9 +109,10 @@ namespace commands {
         virtual ~Command() = default;
 
         virtual bool subcommand_of(CommandType type) = 0;
+        // Applies the command to config, which isn't necessarily the running one
         // Returns whether the caller should continue after this function returns
         // Mainly used in binds, so that bind execution doesn't continue after a reload
-        virtual bool execute(ConfigLoadPhase phase) = 0;
+        virtual bool execute(config::Config& config, ConfigLoadPhase phase) = 0;
     };
 
     struct SetCommand : Command {
@@ -57,9 +121,9 @@ namespace commands {
 
         SetCommand(int line, std::string name, ParsableContent content);
 
-        static SetCommand* parse(int line, std::vector<std::string> args);
+        static SetCommand* parse(int line, Args args);
         bool subcommand_of(CommandType type) override;
-        bool execute(ConfigLoadPhase phase) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
     };
 
     struct EnvCommand : Command {
@@ -68,9 +132,9 @@ namespace commands {
 
         EnvCommand(int line, std::string name, ParsableContent content);
 
-        static EnvCommand* parse(int line, std::vector<std::string> args);
+        static EnvCommand* parse(int line, Args args);
         bool subcommand_of(CommandType type) override;
-        bool execute(ConfigLoadPhase phase) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
     };
 
     struct ExecCommand : Command {
@@ -78,9 +142,9 @@ namespace commands {
 
         ExecCommand(int line, ParsableContent content);
 
-        static ExecCommand* parse(int line, std::vector<std::string> args);
+        static ExecCommand* parse(int line, Args args);
         bool subcommand_of(CommandType type) override;
-        bool execute(ConfigLoadPhase phase) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
     };
 
     struct ExecAlwaysCommand : Command {
@@ -88,9 +152,9 @@ namespace commands {
 
         ExecAlwaysCommand(int line, ParsableContent content);
 
-        static ExecAlwaysCommand* parse(int line, std::vector<std::string> args);
+        static ExecAlwaysCommand* parse(int line, Args args);
         bool subcommand_of(CommandType type) override;
-        bool execute(ConfigLoadPhase phase) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
     };
 
     struct OutputCommand : Command {
@@ -102,6 +166,10 @@ namespace commands {
         std::optional<wl_output_transform> transform;
         std::optional<double> scale;
         std::optional<bool> adaptive_sync;
+        std::optional<ParsableContent> mirror;
+        std::optional<ParsableContent> group;
+        // Image path or color, and how images are fitted
+        std::optional<std::pair<ParsableContent, config::BackgroundMode>> background;
 
         OutputCommand(int line, ParsableContent output_name,
                       std::optional<bool> enabled = std::nullopt,
@@ -109,11 +177,29 @@ namespace commands {
                       std::optional<Position> position = std::nullopt,
                       std::optional<wl_output_transform> transform = std::nullopt,
                       std::optional<double> scale = std::nullopt,
-                      std::optional<bool> adaptive_sync = std::nullopt);
+                      std::optional<bool> adaptive_sync = std::nullopt,
+                      std::optional<ParsableContent> mirror = std::nullopt,
+                      std::optional<ParsableContent> group = std::nullopt,
+                      std::optional<std::pair<ParsableContent, config::BackgroundMode>>
+                          background = std::nullopt);
+
+        static OutputCommand* parse(int line, Args args);
+        bool subcommand_of(CommandType type) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
+    };
 
-        static OutputCommand* parse(int line, std::vector<std::string> args);
+    // Creates headless outputs at runtime and destroys them
+    struct HeadlessOutputCommand : Command {
+        // Set when creating, otherwise the output called output_name is destroyed
+        std::optional<Mode> mode;
+        std::optional<ParsableContent> output_name;
+
+        HeadlessOutputCommand(int line, std::optional<Mode> mode,
+                              std::optional<ParsableContent> output_name);
+
+        static HeadlessOutputCommand* parse(int line, Args args);
         bool subcommand_of(CommandType type) override;
-        bool execute(ConfigLoadPhase phase) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
     };
 
     struct BindCommand : Command {
@@ -123,33 +209,33 @@ namespace commands {
         BindCommand(int line, ParsableContent keybind, Command* command);
         ~BindCommand() override;
 
-        static BindCommand* parse(int line, std::vector<std::string> args);
+        static BindCommand* parse(int line, Args args);
         bool subcommand_of(CommandType type) override;
-        bool execute(ConfigLoadPhase phase) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
     };
 
     struct TerminateCommand : Command {
         TerminateCommand(int line);
 
-        static TerminateCommand* parse(int line, std::vector<std::string> args);
+        static TerminateCommand* parse(int line, Args args);
         bool subcommand_of(CommandType type) override;
-        bool execute(ConfigLoadPhase phase) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
     };
 
     struct ReloadCommand : Command {
         ReloadCommand(int line);
 
-        static ReloadCommand* parse(int line, std::vector<std::string> args);
+        static ReloadCommand* parse(int line, Args args);
         bool subcommand_of(CommandType type) override;
-        bool execute(ConfigLoadPhase phase) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
     };
 
     struct KillCommand : Command {
         KillCommand(int line);
 
-        static KillCommand* parse(int line, std::vector<std::string> args);
+        static KillCommand* parse(int line, Args args);
         bool subcommand_of(CommandType type) override;
-        bool execute(ConfigLoadPhase phase) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
     };
 
     struct WorkspaceCommand : Command {
@@ -157,75 +243,73 @@ namespace commands {
 
         WorkspaceCommand(int line, int id);
 
-        static WorkspaceCommand* parse(int line, std::vector<std::string> args);
+        static WorkspaceCommand* parse(int line, Args args);
         bool subcommand_of(CommandType type) override;
-        bool execute(ConfigLoadPhase phase) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
     };
 
     struct FullscreenCommand : Command {
         FullscreenCommand(int line);
 
-        static FullscreenCommand* parse(int line, std::vector<std::string> args);
+        static FullscreenCommand* parse(int line, Args args);
         bool subcommand_of(CommandType type) override;
-        bool execute(ConfigLoadPhase phase) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
     };
 
-    // Used for debugging, will have different functions over time
-    struct DebugCommand : Command {
-        DebugCommand(int line);
+    struct WatchdogBudgetCommand : Command {
+        // In nanoseconds
+        uint64_t budget;
+
+        WatchdogBudgetCommand(int line, uint64_t budget);
 
-        static DebugCommand* parse(int line, std::vector<std::string> args);
+        static WatchdogBudgetCommand* parse(int line, Args args);
         bool subcommand_of(CommandType type) override;
-        bool execute(ConfigLoadPhase phase) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
     };
-}
 
-namespace parsing {
-    enum class TokenType { UNKNOWN, FILE_END, NEW_LINE, ARG, STRING, BRACKET_OPEN, BRACKET_CLOSE };
+    struct ClientLimitCommand : Command {
+        enum class Limit { COMMIT_RATE, BUFFER_MB, ACTION };
 
-    // A whole lexer and parser might be overkill for this, but who cares
-    struct Token {
-        int line;
-        TokenType type;
-        std::optional<std::string> val;
+        Limit limit;
+        // Hz, MiB, or whether to throttle for ACTION
+        uint64_t value;
 
-        Token(int line, TokenType type);
-        Token(int line, TokenType type, std::string val);
-    };
+        ClientLimitCommand(int line, Limit limit, uint64_t value);
 
-    class Lexer {
-        public:
-        Lexer(const std::string& text);
-        std::vector<Token> get_tokens();
+        static ClientLimitCommand* parse(int line, Args args);
+        bool subcommand_of(CommandType type) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
+    };
 
-        private:
-        std::string text;
-        size_t index;
-        int line;
+    struct FocusBoostCommand : Command {
+        int levels;
 
-        char consume();
-        char peek();
+        FocusBoostCommand(int line, int levels);
 
-        std::optional<Token> read_token();
-        std::string read_word();
-        std::optional<std::string> read_string();
+        static FocusBoostCommand* parse(int line, Args args);
+        bool subcommand_of(CommandType type) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
     };
 
-    class Parser {
-        public:
-        Parser(const std::string& text);
+    struct XwaylandCommand : Command {
+        config::XwaylandMode mode;
 
-        std::vector<commands::Command*> parse();
+        XwaylandCommand(int line, config::XwaylandMode mode);
 
-        private:
-        std::vector<Token> tokens;
-        size_t index;
+        static XwaylandCommand* parse(int line, Args args);
+        bool subcommand_of(CommandType type) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
+    };
 
-        Token consume();
-        Token peek();
+    // Used for debugging, will have different functions over time
+    struct DebugCommand : Command {
+        DebugCommand(int line);
 
-        std::vector<commands::Command*> read_commands();
-        std::vector<std::vector<std::string>> read_block();
+        static DebugCommand* parse(int line, Args args);
+        bool subcommand_of(CommandType type) override;
+        bool execute(config::Config& config, ConfigLoadPhase phase) override;
     };
-
 }
+
+// Creates the command called name, or returns nullptr (and logs the error) if it's invalid
+commands::Command* parse_command(std::string_view name, int line, commands::Args args);
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <sys/types.h>
+
+#include <array>
 #include <filesystem>
 #include <optional>
 #include <string>
@@ -21,13 +24,25 @@ namespace config {
 
         Bind(uint32_t modifiers, xkb_keysym_t sym);
 
-        bool operator==(const Bind &other) {
+        bool operator==(const Bind &other) const {
             return modifiers == other.modifiers && sym == other.sym;
         }
 
         static std::optional<Bind> from_str(int line, std::string text);
     };
 
+    enum class BackgroundMode { STRETCH, FILL, FIT, CENTER, TILE };
+
+    struct Background {
+        // Path of the image, a solid color if empty
+        std::string image;
+        BackgroundMode mode;
+        // RGBA, of the whole output for solid colors, else of what the image doesn't cover
+        std::array<float, 4> color;
+
+        bool operator==(const Background &other) const = default;
+    };
+
     struct OutputConfig {
         // std::string name;
         bool enabled;  // default: true
@@ -36,20 +51,60 @@ namespace config {
         wl_output_transform transform;  // default: WL_OUTPUT_TRANSFORM_NORMAL (0)
         double scale;                   // default: 1.0
         bool adaptive_sync;             // default: false
+        // Name of the output to show instead of the scene
+        std::optional<std::string> mirror;  // default: none
+        // Outputs of a group share one frame clock and are committed together
+        std::optional<std::string> group;   // default: none
+        std::optional<Background> background;  // default: none
 
         OutputConfig(/*std::string name*/);
         OutputConfig(wlr_output_configuration_head_v1 *config);
+
+        bool operator==(const OutputConfig &other) const = default;
+    };
+
+    // Limits above which a client is logged as misbehaving, 0 disables a limit
+    struct ClientLimits {
+        uint32_t commit_rate = 0;
+        uint64_t buffer_bytes = 0;
+        // Holds back frame done events of clients over the commit rate
+        bool throttle = false;
+    };
+
+    enum class XwaylandMode {
+        DISABLED,
+        // Xwayland only gets started when an X client connects
+        LAZY,
+        FORCE
     };
 
     class Config {
         public:
         void set_config_path(std::filesystem::path path);
-        void load();
+        // Returns false if the config file couldn't be read
+        bool load();
+        // The part of load that only reads and parses the file, which is
+        // safe to run on a worker thread
+        bool read();
+        // Imports the environment into vars, on the main thread
+        void import_env();
         void execute_phase(ConfigLoadPhase phase);
+        // Reads the config file into a new config on a worker thread, then only
+        // applies what changed compared to this one before replacing it
+        void reload();
 
-        std::unordered_map<std::string, std::string> vars;
+        commands::VarTable vars;
         std::vector<std::pair<Bind, commands::Command *>> binds;
         std::unordered_map<std::string, OutputConfig> output_config;
+        // exec_always commands, with the pid running each of them (-1 if not started)
+        std::vector<std::pair<std::string, pid_t>> daemons;
+        // Dispatch time after which the watchdog logs a stall, in nanoseconds
+        uint64_t watchdog_budget = 16 * 1000 * 1000;
+        ClientLimits client_limits;
+        // Nice levels the focused client gains, 0 disables it
+        int focus_boost = 0;
+        // Only read at startup
+        XwaylandMode xwayland = XwaylandMode::LAZY;
 
         std::vector<commands::Command *> commands;
 
@@ -59,9 +114,12 @@ namespace config {
 
         private:
         std::filesystem::path config_path;
+        // Set while the new config is being read by a worker
+        bool reloading = false;
 
         void default_config_path();
-        std::string read_file();
+        // Applies the differences between this config and next, then swaps their state
+        void apply_changes(Config &next);
     };
 }
 
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace parsing {
+    enum class TokenType { UNKNOWN, FILE_END, NEW_LINE, ARG, STRING, BRACKET_OPEN, BRACKET_CLOSE };
+
+    // Tokens point into the lexed text, so the text has to outlive them
+    struct Token {
+        int line;
+        TokenType type;
+        std::string_view val;
+    };
+
+    // Read-only private mapping of a whole file
+    class MappedFile {
+        public:
+        MappedFile(const char* path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // False if the file couldn't be opened or mapped
+        bool valid();
+        std::string_view text();
+
+        private:
+        void* data;
+        size_t size;
+        bool ok;
+    };
+
+    class Lexer {
+        public:
+        Lexer(std::string_view text);
+
+        // Returns the next token, or FILE_END once the text is over
+        Token next();
+
+        private:
+        std::string_view text;
+        size_t index;
+        int line;
+
+        char peek();
+
+        Token read_word();
+        Token read_string();
+    };
+
+    // A single command, with the prefix of its block (if any) already applied
+    struct Statement {
+        int line;
+        // Range of the statement in Parser::words, the first word is the command name
+        size_t first;
+        size_t count;
+    };
+
+    // Recursive descent parser over the lexer's tokens
+    //
+    // config  := { NEW_LINE | command }
+    // command := ARG { word } ( block | end )
+    // block   := '{' { NEW_LINE | word { word } end } '}'
+    // word    := ARG | STRING
+    // end     := NEW_LINE | FILE_END | '}'
+    //
+    // Nothing is copied, words are views into the parsed text
+    class Parser {
+        public:
+        std::vector<Statement> statements;
+
+        Parser(std::string_view text);
+
+        void parse();
+
+        std::span<const std::string_view> words(const Statement& statement) const;
+
+        private:
+        Lexer lexer;
+        Token current;
+
+        // Words of every statement, block prefixes are repeated for each block line
+        std::vector<std::string_view> all_words;
+
+        void advance();
+        // Skips everything until the end of the current line
+        void recover();
+
+        void read_command();
+        void read_block(int line, size_t prefix_first, size_t prefix_count);
+        // Reads words until the end of the line, returns how many were read
+        size_t read_words();
+    };
+}
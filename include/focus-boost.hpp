@@ -0,0 +1,13 @@
+#pragma once
+
+#include "wlr.hpp"
+
+// Lowers the nice value of the process owning the focused toplevel (focus_boost in the
+// config), so it wins against background clients for the CPU
+// Nice values are per thread on Linux, so every thread of the process is changed
+namespace focus_boost {
+    // Boosts the client of the surface and restores the previous one, null only restores
+    void focus(wlr_surface* surface);
+    // Gives the boosted process its original nice values back
+    void restore();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+#include "wlr-wrapper.hpp"
+#include "wlr.hpp"
+
+// fifo-v1 and commit-timing-v1, which wlroots-0.19 doesn't implement
+// Commits waiting for a fifo barrier or a target time are held with a lock on the surface's
+// pending state, and released from the frame events of the outputs showing the surface
+namespace frame_pacing {
+    // Creates the globals
+    void init(wl_display* display);
+    // Called on every frame event of an output, before the scene gets committed
+    // Clears the barriers presented by the last frame, then applies the held commits that
+    // are ready for the next one
+    void frame(wlr_output* output);
+
+    int timeout(void* data);
+
+    // Fifo and commit timer state of a surface, lives as long as the surface
+    class Surface {
+        friend int timeout(void*);
+        friend void frame(wlr_output*);
+        friend void client_commit(wl_listener*, void*);
+        friend void surface_destroy(wl_listener*, void*);
+
+        public:
+        wlr_surface* surface;
+        // Null while the surface has no fifo or commit timer object
+        wl_resource* fifo;
+        wl_resource* timer;
+
+        // Requested for the next commit
+        bool set_barrier;
+        bool wait_barrier;
+        // CLOCK_MONOTONIC nanoseconds, 0 if not set
+        uint64_t timestamp;
+
+        Surface(wlr_surface* surface);
+        ~Surface();
+
+        // Applies the held commits whose barrier is cleared and whose timestamp is at most
+        // lookahead_ns away
+        void release(uint64_t now, uint64_t lookahead_ns);
+
+        private:
+        struct Commit {
+            uint32_t lock;
+            bool set_barrier;
+            bool wait_barrier;
+            uint64_t timestamp;
+        };
+
+        // Set by the last applied commit with set_barrier
+        bool barrier;
+        // The content that set the barrier went out with an output commit
+        bool barrier_shown;
+        // Later commits queue up behind the first held one, in order
+        std::deque<Commit> held;
+        wl_event_source* wakeup;
+
+        bool ready(const Commit& commit, uint64_t now, uint64_t lookahead_ns);
+        // Shortest refresh period of the outputs the surface is on, 0 if it's on none
+        uint64_t refresh_ns();
+        void schedule_frames();
+        // Arms whatever releases the first held commit, a frame or the wakeup timer
+        void wait(uint64_t now);
+
+        wrapper::Listener<Surface> client_commit;
+        wrapper::Listener<Surface> destroy;
+    };
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+
+#include "wlr-wrapper.hpp"
+#include "wlr.hpp"
+
+// ext-idle-notify-v1 and idle-inhibit-unstable-v1, for idle daemons and video players
+namespace idle {
+    int flush_activity(void* data);
+
+    class Inhibitor {
+        friend void inhibitor_destroy(wl_listener*, void*);
+
+        public:
+        wlr_idle_inhibitor_v1* inhibitor;
+
+        Inhibitor(wlr_idle_inhibitor_v1* inhibitor);
+
+        private:
+        wrapper::Listener<Inhibitor> destroy;
+    };
+
+    // Input only stores the time of the last activity, the notifier's timers get reset
+    // at most once per flush interval instead of on every event
+    class IdleManager {
+        friend int flush_activity(void*);
+        friend void new_inhibitor(wl_listener*, void*);
+        friend void inhibitor_destroy(wl_listener*, void*);
+        friend void inhibit_manager_destroy(wl_listener*, void*);
+
+        public:
+        IdleManager(wl_display* display);
+
+        // Called on every input event
+        void activity();
+        // Idling is inhibited while the surface of an inhibitor is visible, which includes
+        // a fullscreen toplevel on an active workspace
+        // Called when the visibility of toplevels changes
+        void update_inhibited();
+
+        private:
+        wlr_idle_notifier_v1* notifier;
+        wlr_idle_inhibit_manager_v1* inhibit_manager;
+        std::list<Inhibitor*> inhibitors;
+        bool inhibited;
+
+        wl_event_source* flush_timer;
+        bool flush_armed;
+        uint64_t last_activity_ns;
+        uint64_t notified_ns;
+
+        void notify();
+
+        wrapper::Listener<IdleManager> new_inhibitor;
+        wrapper::Listener<IdleManager> inhibit_manager_destroy;
+    };
+}
@@ -89,9 +89,12 @@ namespace keyboard {
         wlr_keyboard* keyboard;
 
         Keyboard(seat::SeatDevice* keyboard);
+        ~Keyboard();
 
         // Configure keyboard repeat rate, keymap, and set the keyboard in the seat
+        // The keymap is compiled on a worker, so it may only be set later
         void configure();
+        void set_keymap(xkb_keymap* keymap);
 
         private:
         seat::SeatDevice* seat_dev;
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+
+#include "wlr.hpp"
+
+// UNIX socket IPC, the socket path is exported to children as DWC_SOCK
+//
+// Every message is a frame: an 8 byte header followed by the payload
+//   u32 payload length, u16 message type, u16 reserved (0)
+// Integers are in host byte order, strings are a u32 length followed by the bytes
+//
+// Requests and their reply payloads (replies use the request's type):
+//   COMMAND         request: the command text, with the same syntax as binds
+//                   reply:   u8 success, string error
+//   GET_OUTPUTS     u32 count, then for each output:
+//                   string name, u8 enabled, i32 x, i32 y, i32 width, i32 height,
+//                   u32 refresh (mHz), u32 scale (thousandths), i32 active workspace
+//   GET_WORKSPACES  u32 count, then for each workspace ordered by id:
+//                   i32 id, string output, u8 visible, u8 fullscreen, u32 toplevels
+//   GET_TOPLEVELS   u32 count, then for each toplevel:
+//                   u32 id, string app_id, string title, i32 workspace,
+//                   i32 x, i32 y, i32 width, i32 height, u8 fullscreen
+//   GET_FOCUS       u32 toplevel (0 if none), string app_id, string title,
+//                   i32 workspace (-1 if none), string output
+//   SUBSCRIBE       request: u32 mask of Subscription
+//                   reply:   u8 success, then the current state of every subscribed event
+//   TRACE           request: u8 1 to start tracing, 0 to stop it
+//                   reply:   u8 tracing, string path of the trace written when stopping
+//   GET_WATCHDOG    u64 iterations, u64 total, u64 max, u64 stalls, u32 count, then for
+//                   each handler ordered by total time:
+//                   string name, u64 calls, u64 total, u64 max, u64 stalls
+//                   Times are in nanoseconds, stalls are the times the budget was exceeded
+//   GET_METRICS     string of every metric in the Prometheus text exposition format
+//   GET_CLIENTS     u32 count, then for each client:
+//                   i32 pid, u64 commits, u32 commit rate (Hz), u64 buffer bytes,
+//                   u64 attached bytes, u64 shm buffers, u64 dmabuf buffers, u64 upload bytes,
+//                   u64 frame callbacks, u32 outstanding configures, u8 throttled
+//
+// Events are sent to subscribed clients with the same payload as the matching query
+// They carry the whole state and are coalesced, so each one replaces the previous
+// Clients that don't read fast enough get the latest state once they catch up
+namespace ipc {
+    int handle_connection(int fd, uint32_t mask, void* data);
+    int handle_client(int fd, uint32_t mask, void* data);
+    void flush_events(void* data);
+
+    constexpr size_t HEADER_SIZE = 8;
+
+    enum class MessageType : uint16_t {
+        COMMAND = 0,
+        GET_OUTPUTS = 1,
+        GET_WORKSPACES = 2,
+        GET_TOPLEVELS = 3,
+        GET_FOCUS = 4,
+        SUBSCRIBE = 5,
+        TRACE = 6,
+        GET_WATCHDOG = 7,
+        GET_METRICS = 8,
+        GET_CLIENTS = 9,
+
+        EVENT_WORKSPACE = 0x8000,
+        EVENT_FOCUS = 0x8001,
+        EVENT_OUTPUT = 0x8002,
+    };
+
+    enum Subscription : uint32_t {
+        SUBSCRIBE_WORKSPACE = 1 << 0,
+        SUBSCRIBE_FOCUS = 1 << 1,
+        SUBSCRIBE_OUTPUT = 1 << 2,
+
+        SUBSCRIBE_ALL = SUBSCRIBE_WORKSPACE | SUBSCRIBE_FOCUS | SUBSCRIBE_OUTPUT,
+    };
+
+    // Builds a single frame
+    class Message {
+        public:
+        std::string data;
+
+        Message(MessageType type);
+
+        void u8(uint8_t val);
+        void u32(uint32_t val);
+        void i32(int32_t val);
+        void u64(uint64_t val);
+        void str(std::string_view val);
+
+        // Writes the payload length in the header
+        void finish();
+    };
+
+    class Client {
+        public:
+        int fd;
+        wl_event_source* source;
+
+        std::string in;
+        std::string out;
+        // Bytes of out that have already been sent
+        size_t out_sent;
+
+        uint32_t subscriptions;
+        // Events held back because the client wasn't reading
+        uint32_t held_events;
+
+        // The client shut down its side, it's dropped once the replies are sent
+        bool eof;
+
+        Client(int fd);
+
+        // Bytes queued but not sent yet
+        size_t backlog();
+    };
+
+    class IpcServer {
+        friend int handle_connection(int, uint32_t, void*);
+        friend int handle_client(int, uint32_t, void*);
+        friend void flush_events(void*);
+
+        public:
+        IpcServer(wl_display* display);
+        ~IpcServer();
+
+        // Creates the socket in XDG_RUNTIME_DIR and sets DWC_SOCK
+        bool start();
+
+        // Marks events as changed, subscribers get them once the current dispatch is done
+        void notify(uint32_t events);
+
+        private:
+        wl_event_loop* loop;
+        int fd;
+        wl_event_source* source;
+        std::string path;
+
+        std::list<Client*> clients;
+
+        // Events changed since the last flush
+        uint32_t dirty_events;
+        bool flush_scheduled;
+
+        void disconnect(Client* client);
+
+        // All of these return false if the client has to be disconnected
+        bool read_input(Client* client);
+        // Handles complete messages, stops while the client is behind on reading replies
+        bool process_input(Client* client);
+        bool handle_message(Client* client, MessageType type, std::string_view payload);
+        bool write_out(Client* client);
+
+        // Polls for writes only while there's something queued, and for reads only
+        // while the client keeps up with the replies
+        void update_mask(Client* client);
+
+        void queue(Client* client, const Message& message);
+        // Queues the events, or holds them back if the client is too far behind
+        void queue_events(Client* client, uint32_t events);
+
+        // Builds the message of a single Subscription
+        Message event(uint32_t event);
+
+        Message outputs(MessageType type);
+        Message workspaces(MessageType type);
+        Message toplevels(MessageType type);
+        Message focus(MessageType type);
+        Message watchdog_stats();
+        Message client_stats();
+        Message command(std::string_view text);
+    };
+}
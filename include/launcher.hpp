@@ -0,0 +1,58 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "wlr.hpp"
+
+namespace launcher {
+    int handle_sigchld(int signal_number, void* data);
+
+    // A child process spawned by the compositor
+    struct Process {
+        pid_t pid;
+        std::string command;
+        // CLOCK_MONOTONIC time of the spawn, in nanoseconds
+        uint64_t spawn_time;
+    };
+
+    // Spawns commands with posix_spawn, which uses vfork semantics and
+    // doesn't copy the compositor's page tables, and reaps the children
+    // from a SIGCHLD event loop source
+    class Launcher {
+        friend int handle_sigchld(int, void*);
+
+        public:
+        // Launch statistics, latencies are in nanoseconds
+        struct {
+            uint64_t launched;
+            uint64_t failed;
+            uint64_t total_latency;
+            uint64_t max_latency;
+        } stats;
+
+        Launcher(wl_display* display);
+
+        // Runs the command with sh -c in a new session, with default signal
+        // dispositions, an empty signal mask and the current environment
+        // Returns the pid of the child, or -1 on failure
+        pid_t spawn(const std::string& command);
+
+        // Whether a process spawned by the launcher is still running
+        bool running(pid_t pid);
+        // Sends SIGTERM to the process group of a running child
+        void terminate(pid_t pid);
+
+        private:
+        wl_event_source* sigchld_source;
+
+        // Children that haven't been reaped yet
+        std::unordered_map<pid_t, Process> children;
+
+        // Reaps every child that has exited
+        void reap();
+    };
+}
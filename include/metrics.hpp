@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "wlr.hpp"
+
+// Counters and gauges for the whole compositor, exported in the Prometheus text format
+// through the GET_METRICS IPC message
+// Updates are relaxed atomics, so they're cheap enough for the hot paths
+namespace metrics {
+    class Counter {
+        public:
+        void inc(uint64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+        uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+        private:
+        std::atomic<uint64_t> value { 0 };
+    };
+
+    class Gauge {
+        public:
+        void inc() { value.fetch_add(1, std::memory_order_relaxed); }
+        void dec() { value.fetch_sub(1, std::memory_order_relaxed); }
+        int64_t get() const { return value.load(std::memory_order_relaxed); }
+
+        private:
+        std::atomic<int64_t> value { 0 };
+    };
+
+    // Per output frame counts are kept by the outputs themselves, and per client
+    // statistics by the clients module
+    extern Counter hit_tests;
+    extern Counter focus_changes;
+    // Configure events sent to xdg toplevels and popups
+    extern Counter xdg_configures;
+    extern Counter toplevels_created;
+    extern Counter toplevels_destroyed;
+    extern Counter popups_created;
+    extern Counter popups_destroyed;
+    extern Counter layer_surfaces_created;
+    extern Counter layer_surfaces_destroyed;
+
+    extern Gauge seat_nodes;
+
+    // All the metrics in the Prometheus text exposition format
+    std::string dump();
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <optional>
+
+#include "config/config.hpp"
+#include "wlr.hpp"
+
+// Last state successfully committed to each monitor, keyed by make, model and serial
+// (the connector name stands in for a missing serial)
+// rather than connector name, so a monitor gets it back on any port with a single modeset
+// Kept in $XDG_STATE_HOME/dwc/output-cache, one line per monitor
+namespace output_cache {
+    // Nothing if the monitor was never configured or can't be identified
+    std::optional<config::OutputConfig> lookup(wlr_output* output);
+    // Remembers the current state of an enabled output, the file is written on a worker
+    // The position is only kept if it was configured, not picked by the layout
+    void store(wlr_output* output, bool positioned);
+}
@@ -3,6 +3,7 @@
 #include <string>
 
 #include "config/config.hpp"
+#include "metrics.hpp"
 #include "root.hpp"
 #include "wlr-wrapper.hpp"
 #include "wlr.hpp"
@@ -16,11 +17,23 @@ namespace output {
     class Output {
         friend void frame(wl_listener*, void*);
         friend void request_state(wl_listener*, void*);
+        friend void commit(wl_listener*, void*);
         friend void output_destroy(wl_listener* listener, void* data);
 
         public:
         wlr_output* output;
+        // Null for mirrors, which don't render the scene
         wlr_scene_output* scene_output;
+        // Output shown by this mirror, resolved from mirror_name
+        Output* mirror_source;
+        std::string mirror_name;
+        // Frame group, empty if the output commits on its own
+        std::string group;
+        // How late this output's last frame event came after the group's first one
+        uint64_t group_drift_ns;
+        // Scene node of the built-in background, null while there is none or it's decoding
+        wlr_scene_node* background;
+        std::optional<config::Background> background_config;
 
         wlr_box output_box;
         wlr_box usable_area;
@@ -28,6 +41,8 @@ namespace output {
         std::list<workspace::Workspace*> workspaces;
         workspace::Workspace* active_workspace;
 
+        metrics::Counter frames;
+
         struct {
             wlr_scene_tree* shell_background;
             wlr_scene_tree* shell_bottom;
@@ -41,6 +56,8 @@ namespace output {
         void update_position();
         void arrange_layers();
         bool apply_config(config::OutputConfig* config, bool test);
+        // Makes the next frame render and commit the whole scene, even if nothing changed
+        void damage_whole();
 
         wlr_scene_tree* get_scene(zwlr_layer_shell_v1_layer layer);
         std::pair<double, double> center();
@@ -48,14 +65,30 @@ namespace output {
         private:
         wrapper::Listener<Output> frame;
         wrapper::Listener<Output> request_state;
+        wrapper::Listener<Output> commit;
         wrapper::Listener<Output> destroy;
 
+        // Last buffer committed, only kept while the output is mirrored
+        wlr_buffer* buffer;
+        // Counts the commits of buffers, so mirrors know when there's a new one
+        uint64_t buffer_seq;
+        // buffer_seq of the source when this mirror last showed it
+        uint64_t mirrored_seq;
+        // Set when the frame event came but the rest of the group hasn't had theirs yet
+        bool frame_pending;
+        uint64_t frame_ns;
+
         void arrange_surface(wlr_box* full_area, wlr_scene_tree* tree, bool exclusive);
+        // Shows the last buffer of the source on this mirror
+        void draw_mirror();
+        // Draws buffer scaled to fit, when it can't be scanned out as is
+        bool render_mirror(wlr_output_state* state, wlr_buffer* buffer);
     };
 
     class OutputManager {
         friend void output_layout_destroy(wl_listener*, void*);
         friend void output_manager_destroy(wl_listener*, void*);
+        friend void output_power_manager_destroy(wl_listener*, void*);
 
         public:
         std::list<Output*> outputs;
@@ -64,15 +97,38 @@ namespace output {
 
         Output* output_at(double x, double y);
         Output* focused_output();
+        // First output with workspaces that renders the scene, other than except
+        // Null if there is none
+        Output* fallback_output(Output* except = nullptr);
+        // Moves the workspaces of an output and their toplevels to the fallback output,
+        // hidden behind its active workspace
+        // Returns false if there is no output to take them
+        bool move_workspaces(Output* from);
 
         void apply_output_config(wlr_output_configuration_v1* config, bool test);
+        // Matches mirrors with their source outputs, after outputs or their configs change
+        void update_mirrors();
+        // Commits a group once all of its outputs had their frame event
+        void group_frame(Output* output);
+        // Lets the rest of a group commit after one of its outputs left it
+        void wake_group(const std::string& group);
+
+        // Adds a headless output, starting the headless backend the first time
+        Output* create_headless(const Mode& mode);
+        // Only destroys headless outputs, real ones can't be unplugged
+        bool destroy_headless(const std::string& name);
 
         private:
+        // Created on the first headless output, owned by the multi backend
+        wlr_backend* headless;
+
         wrapper::Listener<OutputManager> layout_update;
         wrapper::Listener<OutputManager> output_test;
         wrapper::Listener<OutputManager> output_apply;
+        wrapper::Listener<OutputManager> output_power_set_mode;
 
         wrapper::Listener<OutputManager> output_layout_destroy;
         wrapper::Listener<OutputManager> output_manager_destroy;
+        wrapper::Listener<OutputManager> output_power_manager_destroy;
     };
 }
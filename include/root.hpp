@@ -48,6 +48,8 @@ namespace nodes {
     // scene layout (from top to bottom):
     // root
     //      - seat
+    //      - unmanaged
+    //          - [override redirect Xwayland windows]
     //      - fullscreen
     //          - [workspaces fullscreen tree]
     //      - layer popups
@@ -79,6 +81,7 @@ namespace nodes {
         wlr_scene_tree* shell_overlay;
         wlr_scene_tree* layer_popups;
         wlr_scene_tree* fullscreen;
+        wlr_scene_tree* unmanaged;
         wlr_scene_tree* seat;
 
         std::unordered_map<int, workspace::Workspace*> workspaces;
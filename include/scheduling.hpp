@@ -0,0 +1,35 @@
+#pragma once
+
+#include <sched.h>
+#include <sys/types.h>
+
+#include <string>
+
+// Opt-in scheduling setup for the compositor process (-r, -m and -a options), so the
+// cursor keeps moving when every core is busy
+// Everything degrades to the default behaviour when the process lacks the privileges
+namespace scheduling {
+    struct Options {
+        // SCHED_RR priority, 0 to keep the default policy
+        int realtime_priority = 0;
+        bool lock_memory = false;
+        // CPU list like "0,2-3", empty to keep the inherited affinity
+        std::string affinity;
+    };
+
+    // The resulting state, for the logs and the metrics
+    struct State {
+        int policy;
+        int priority;
+        int nice;
+        bool memory_locked;
+        int cpus;
+    };
+
+    extern State state;
+
+    // Called from main before the compositor creates any thread
+    void apply(const Options& options);
+    // Gives a spawned child the nice value and affinity the compositor started with
+    void reset_child(pid_t pid);
+}
@@ -2,17 +2,23 @@
 
 #include <list>
 
+#include "clients.hpp"
+#include "idle.hpp"
 #include "input.hpp"
+#include "ipc.hpp"
+#include "launcher.hpp"
 #include "layer-shell.hpp"
 #include "output.hpp"
 #include "root.hpp"
 #include "wlr.hpp"
+#include "workers.hpp"
 #include "xdg-shell.hpp"
 
 class Server {
     friend void backend_destroy(wl_listener*, void*);
     friend void xdg_shell_destroy(wl_listener*, void*);
     friend void layer_shell_destroy(wl_listener*, void*);
+    friend void compositor_destroy(wl_listener*, void*);
 
     public:
     // Globals
@@ -27,6 +33,7 @@ class Server {
     wlr_scene_output_layout* scene_layout;
 
     // Protocols
+    wlr_compositor* compositor;
     wlr_xdg_shell* xdg_shell;
     wlr_layer_shell_v1* layer_shell;
     wlr_linux_dmabuf_v1* linux_dmabuf_v1;
@@ -34,16 +41,29 @@ class Server {
     wlr_ext_image_copy_capture_manager_v1* ext_image_copy_capture_manager_v1;
     wlr_xdg_output_manager_v1* xdg_output_manager_v1;
     wlr_output_manager_v1* output_manager_v1;
+    wlr_output_power_manager_v1* output_power_manager_v1;
+    wlr_ext_foreign_toplevel_list_v1* ext_foreign_toplevel_list_v1;
+    wlr_ext_foreign_toplevel_image_capture_source_manager_v1*
+        ext_foreign_toplevel_image_capture_source_manager_v1;
 
     // Misc.
     input::InputManager input_manager;
     output::OutputManager output_manager;
+    idle::IdleManager idle;
+    launcher::Launcher launcher;
+    ipc::IpcServer ipc;
+    workers::WorkerPool workers;
 
     std::list<xdg_shell::Toplevel*> toplevels;
 
     Server();
     ~Server();
 
+    // Constructs and destroys the global server, main constructs it once the arguments
+    // are parsed so it can overlap with reading the config
+    static void create();
+    static void destroy();
+
     void start(char* startup_cmd);
 
     xdg_shell::Toplevel* toplevel_at(double lx, double ly, wlr_surface*& surface, double& sx,
@@ -59,11 +79,14 @@ class Server {
     wrapper::Listener<Server> new_output;
     wrapper::Listener<Server> new_xdg_toplevel;
     wrapper::Listener<Server> new_layer_shell_surface;
+    wrapper::Listener<Server> new_surface;
+    wrapper::Listener<Server> new_toplevel_capture_request;
 
     // Cleanup listeners
     wrapper::Listener<Server> backend_destroy;
     wrapper::Listener<Server> xdg_shell_destroy;
     wrapper::Listener<Server> layer_shell_destroy;
+    wrapper::Listener<Server> compositor_destroy;
 };
 
-extern Server server;
+extern Server& server;
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Timing of the compositor bring-up, logged as it goes and exported in GET_METRICS
+// Each phase lasts from the end of the previous one, starting at main
+namespace startup {
+    struct Phase {
+        const char* name;
+        uint64_t duration_ns;
+    };
+
+    extern std::vector<Phase> phases;
+
+    // Starts the clock
+    void begin();
+    // Ends the phase called name, only the first call for a name counts
+    // Nothing is recorded after the first frame
+    void mark(const char* name);
+    // Usable in an initializer list
+    template <typename T>
+    T mark(const char* name, T value) {
+        mark(name);
+        return value;
+    }
+    // For work done on another thread, which doesn't end a phase
+    void record(const char* name, uint64_t duration_ns);
+
+    // Tells the service manager that clients can connect, with the sd_notify protocol
+    // but without libsystemd. Does nothing if NOTIFY_SOCKET isn't set
+    void notify_ready(const char* status);
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "wlr.hpp"
+#include "xdg-shell.hpp"
+
+// ext-foreign-toplevel-image-capture-source, to record a single window
+namespace toplevel_capture {
+    // Called when a client asks for a capture source for a foreign toplevel handle
+    void new_request(wl_listener* listener, void* data);
+
+    // Capture source rendering a second view of the toplevel in a scene of its own, so
+    // other windows never end up in it and it keeps working on hidden workspaces
+    // One per toplevel, shared by all its capture requests and deleted with the toplevel
+    // The source is destroyed with the scene node it renders, so it can't outlive it
+    class Capture {
+        public:
+        wlr_scene* scene;
+        wlr_ext_image_capture_source_v1* source;
+
+        // The source is null if it couldn't be created
+        Capture(xdg_shell::Toplevel* toplevel);
+        ~Capture();
+    };
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "util.hpp"
+#include "wlr.hpp"
+
+// Records a trace event covering the rest of the enclosing scope
+// name has to be a string literal, only the pointer is stored
+#define TRACE_SCOPE(name) trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_CONCAT_INNER(a, b) a##b
+
+// Built-in tracer for the compositor's hot paths
+// Events go into a fixed size ring buffer, which is written as a Chrome trace
+// JSON file (also loaded by Perfetto) when tracing is stopped
+// Tracing is toggled with SIGUSR2 or through IPC
+namespace trace {
+    int handle_sigusr2(int signal_number, void* data);
+
+    // Checked by every trace point, a disabled trace point is a load and a branch
+    extern std::atomic<bool> enabled;
+
+    // Adds the SIGUSR2 source to the event loop
+    void init(wl_display* display);
+
+    // Clears the ring buffer and starts recording
+    void start();
+    // Stops recording and writes the trace, returns the path of the file or an empty
+    // string if tracing wasn't running or the file couldn't be written
+    std::string stop();
+
+    // Adds a complete event to the ring buffer, overwriting the oldest one when full
+    // Times are CLOCK_MONOTONIC nanoseconds
+    void record(const char* name, uint64_t start, uint64_t end);
+
+    class Scope {
+        public:
+        Scope(const char* name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        private:
+        // Null if tracing was disabled when the scope started
+        const char* name;
+        uint64_t start;
+    };
+
+    inline Scope::Scope(const char* name)
+        : name(enabled.load(std::memory_order_relaxed) ? name : nullptr),
+          start(this->name ? now_ns() : 0) {}
+
+    inline Scope::~Scope() {
+        if(name)
+            record(name, start, now_ns());
+    }
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 
 #include "wlr.hpp"
@@ -10,12 +11,18 @@ struct Mode {
     int width;
     int height;
     double refresh_rate;
+
+    bool operator==(const Mode &other) const = default;
 };
 
 struct Position {
     int x;
     int y;
+
+    bool operator==(const Position &other) const = default;
 };
 
 void trim(std::string &s);
 std::string device_identifier(wlr_input_device *device);
+// CLOCK_MONOTONIC time in nanoseconds
+uint64_t now_ns();
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "util.hpp"
+#include "wlr.hpp"
+
+// Measures how long every event loop iteration and every listener callback takes
+// Anything over the budget (watchdog_budget in the config) is logged, and cumulative
+// statistics are kept for the whole session
+namespace watchdog {
+    using Callback = void(wl_listener*, void*);
+
+    // Times are in nanoseconds
+    struct HandlerStats {
+        uint64_t calls;
+        uint64_t total;
+        uint64_t max;
+        // Calls that went over the budget
+        uint64_t stalls;
+    };
+
+    struct LoopStats {
+        uint64_t iterations;
+        // Time spent dispatching, excluding the time spent waiting for events
+        uint64_t total;
+        uint64_t max;
+        uint64_t stalls;
+    };
+
+    extern LoopStats loop_stats;
+    // Keyed by callback, times include nested callbacks
+    extern std::unordered_map<Callback*, HandlerStats> handler_stats;
+
+    // Replaces wl_display_run, dispatches until terminate() is called
+    void run(wl_display* display);
+    void terminate(wl_display* display);
+
+    // Called by wrapper::Listener after every callback
+    void record(Callback* callback, uint64_t start, uint64_t end);
+
+    // Symbol name of the callback, or its offset in the binary if it has none
+    std::string handler_name(Callback* callback);
+    // Logs the loop statistics and the handlers that took the most time
+    void log_stats();
+}
@@ -2,6 +2,7 @@
 
 #include <wayland-server-core.h>
 
+#include "watchdog.hpp"
 #include "wlr.hpp"
 
 namespace wrapper {
@@ -11,9 +12,10 @@ namespace wrapper {
 
         public:
         Listener(Container* cont, Callback cb, wl_signal* signal)
-            : freed(false) {
+            : callback(cb),
+              freed(false) {
             container = cont;
-            notify = cb;
+            notify = dispatch;
             wl_signal_add(signal, this);
         }
 
@@ -30,6 +32,17 @@ namespace wrapper {
         Container* container;
 
         private:
+        Callback* callback;
         bool freed;
+
+        // Times the callback for the watchdog
+        static void dispatch(wl_listener* listener, void* data) {
+            // The callback can destroy the listener
+            Callback* cb = static_cast<Listener*>(listener)->callback;
+
+            uint64_t start = now_ns();
+            cb(listener, data);
+            watchdog::record(cb, start, now_ns());
+        }
     };
 }
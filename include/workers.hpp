@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "wlr.hpp"
+
+namespace workers {
+    int handle_completion(int fd, uint32_t mask, void* data);
+
+    struct Job {
+        // Runs on a worker thread, so it can't touch compositor state
+        std::function<void()> work;
+        // Runs on the main thread once work is done
+        std::function<void()> done;
+    };
+
+    // Small thread pool for blocking work (disk, parsing, compilation) that
+    // shouldn't stall the event loop
+    // Completions are signalled back to the loop through an eventfd, so results
+    // are applied between two dispatches, never in the middle of one
+    class WorkerPool {
+        friend int handle_completion(int, uint32_t, void*);
+
+        public:
+        WorkerPool(wl_display* display);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        // Threads are started on the first submit, if that fails jobs run inline
+        void submit(std::function<void()> work, std::function<void()> done);
+
+        private:
+        wl_event_loop* loop;
+        int event_fd;
+        wl_event_source* source;
+
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool stopping;
+
+        // Both guarded by mutex
+        std::deque<Job> pending;
+        std::deque<std::function<void()>> completed;
+
+        bool start_threads();
+        void run();
+    };
+}
@@ -20,6 +20,10 @@ namespace workspace {
         xdg_shell::Toplevel* focused_toplevel;
         bool fullscreen;
 
+        int id;
+        // Whether the workspace is the one shown on its output
+        bool active;
+
         Workspace(output::Output* output);
         Workspace(int id);
         Workspace();
@@ -31,10 +35,6 @@ namespace workspace {
         // Called when a new workspace so focused for any reason, like
         // the 'workspace' command or a cursor moving between outputs
         void focus();
-
-        private:
-        int id;
-        bool active;
     };
 
     Workspace* focus_or_create(int id);
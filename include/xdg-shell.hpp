@@ -1,22 +1,77 @@
 #pragma once
 
+#include <list>
+
 #include "root.hpp"
 #include "wlr-wrapper.hpp"
 #include "wlr.hpp"
 
+namespace toplevel_capture {
+    class Capture;
+}
+
 namespace xdg_shell {
     // Called when a new toplevel is created by a client
     void new_xdg_toplevel(wl_listener* listener, void* data);
+    // Sends the queued title and app_id changes to the foreign toplevel list clients
+    // Called on every output frame, so they get at most one update per frame
+    void flush_foreign_toplevels();
+
+    class Popup;
+
+    // Second view of an xdg surface for captures, forgotten once its tree is destroyed
+    // Popups of the surface get views of their own under it
+    class View {
+        friend void view_destroy(wl_listener*, void*);
+
+        public:
+        wlr_scene_tree* tree;
+
+        // Adds itself to views, the owner deletes the remaining ones when it goes away
+        View(wlr_scene_tree* tree, std::list<View*>& views);
 
+        private:
+        std::list<View*>& views;
+
+        wrapper::Listener<View> destroy;
+    };
+
+    // Window managed in the workspaces, implemented by xdg toplevels and Xwayland windows
     class Toplevel {
+        friend void flush_foreign_toplevels();
+
         public:
-        wlr_xdg_toplevel* toplevel;
         nodes::Node node;
 
         wlr_scene_tree* scene_tree;
         workspace::Workspace* workspace;
 
-        Toplevel(wlr_xdg_toplevel* toplevel);
+        // Unique for the whole session, unlike the wlroots objects
+        uint32_t id;
+        // ext-foreign-toplevel-list handle, only while mapped
+        wlr_ext_foreign_toplevel_handle_v1* foreign_handle;
+        // Capture source shared by every capture of the window, created on the first one
+        toplevel_capture::Capture* capture;
+
+        Toplevel(wlr_scene_tree* scene_tree);
+        virtual ~Toplevel();
+
+        virtual wlr_surface* surface() = 0;
+        // Window geometry, relative to the surface
+        virtual wlr_box geometry() = 0;
+        virtual const char* app_id() = 0;
+        virtual const char* title() = 0;
+
+        virtual void set_size(int width, int height) = 0;
+        virtual void set_activated(bool activated) = 0;
+        virtual void set_fullscreen(bool fullscreen) = 0;
+        // Asks the client to close the window
+        virtual void close() = 0;
+        // Another view of the window's surfaces under parent, for captures
+        // Returns null if the window has no surface
+        virtual wlr_scene_tree* create_view(wlr_scene_tree* parent) = 0;
+        // In layout coordinates
+        virtual void set_position(int x, int y);
 
         output::Output* output();
         // Toggles fullscreen status
@@ -24,34 +79,93 @@ namespace xdg_shell {
         // Sets size and position of a fullscreened toplevel
         void update_fullscreen();
 
+        protected:
+        // Places the mapped toplevel on the focused workspace
+        void handle_map(uint32_t width, uint32_t height);
+        void handle_unmap();
+        void handle_title_change();
+        void handle_app_id_change();
+
         private:
         // To restore the original geometry on exit fullscreen
         wlr_box saved_geometry;
+        // Whether the foreign handle has an update queued for the next frame
+        bool foreign_dirty;
+
+        void queue_foreign_update();
+    };
+
+    class XdgToplevel : public Toplevel {
+        public:
+        wlr_xdg_toplevel* toplevel;
+
+        XdgToplevel(wlr_xdg_toplevel* toplevel);
+        ~XdgToplevel() override;
 
-        wrapper::Listener<Toplevel> map;
-        wrapper::Listener<Toplevel> unmap;
-        wrapper::Listener<Toplevel> commit;
-        wrapper::Listener<Toplevel> destroy;
+        wlr_surface* surface() override;
+        wlr_box geometry() override;
+        const char* app_id() override;
+        const char* title() override;
 
-        wrapper::Listener<Toplevel> request_move;
-        wrapper::Listener<Toplevel> request_resize;
-        wrapper::Listener<Toplevel> request_maximize;
-        wrapper::Listener<Toplevel> request_minimize;
-        wrapper::Listener<Toplevel> request_fullscreen;
+        void set_size(int width, int height) override;
+        void set_activated(bool activated) override;
+        void set_fullscreen(bool fullscreen) override;
+        void close() override;
+        wlr_scene_tree* create_view(wlr_scene_tree* parent) override;
 
-        wrapper::Listener<Toplevel> new_popup;
+        private:
+        friend void xdg_toplevel_map(wl_listener*, void*);
+        friend void xdg_toplevel_unmap(wl_listener*, void*);
+        friend void xdg_toplevel_set_title(wl_listener*, void*);
+        friend void xdg_toplevel_set_app_id(wl_listener*, void*);
+        friend void xdg_toplevel_new_popup(wl_listener*, void*);
+
+        std::list<View*> views;
+        std::list<Popup*> popups;
+
+        wrapper::Listener<XdgToplevel> map;
+        wrapper::Listener<XdgToplevel> unmap;
+        wrapper::Listener<XdgToplevel> commit;
+        wrapper::Listener<XdgToplevel> destroy;
+
+        wrapper::Listener<XdgToplevel> request_move;
+        wrapper::Listener<XdgToplevel> request_resize;
+        wrapper::Listener<XdgToplevel> request_maximize;
+        wrapper::Listener<XdgToplevel> request_minimize;
+        wrapper::Listener<XdgToplevel> request_fullscreen;
+        wrapper::Listener<XdgToplevel> set_title;
+        wrapper::Listener<XdgToplevel> set_app_id;
+        wrapper::Listener<XdgToplevel> configure;
+
+        wrapper::Listener<XdgToplevel> new_popup;
     };
 
     class Popup {
+        friend class XdgToplevel;
+        friend void xdg_popup_destroy(wl_listener*, void*);
+        friend void xdg_popup_new_popup(wl_listener*, void*);
+
         public:
         wlr_xdg_popup* popup;
         wlr_scene_tree* scene;
 
-        Popup(wlr_xdg_popup* xdg_popup, wlr_scene_tree* popup);
+        // Also shown in every view of the parent, siblings are the popups of the parent
+        Popup(wlr_xdg_popup* xdg_popup, wlr_scene_tree* parent_tree, std::list<Popup*>& siblings,
+              const std::list<View*>& parent_views);
+        ~Popup();
+
+        // Adds a view of the popup and its children under the view of its parent
+        void create_view(wlr_scene_tree* parent);
 
         private:
+        // Null once the parent is gone
+        std::list<Popup*>* siblings;
+        std::list<View*> views;
+        std::list<Popup*> popups;
+
         wrapper::Listener<Popup> commit;
         wrapper::Listener<Popup> destroy;
+        wrapper::Listener<Popup> configure;
         wrapper::Listener<Popup> new_popup;
     };
 }
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <optional>
+
+#include "wlr-wrapper.hpp"
+#include "wlr.hpp"
+#include "xdg-shell.hpp"
+
+// X11 clients, through an Xwayland server (xwayland in the config)
+// Only built with HAVE_XWAYLAND
+namespace xwayland {
+    class Xwayland {
+        public:
+        wlr_xwayland* xwayland;
+
+        Xwayland(wlr_xwayland* xwayland);
+
+        private:
+        wrapper::Listener<Xwayland> ready;
+        wrapper::Listener<Xwayland> new_surface;
+    };
+
+    // X11 window managed like the xdg toplevels
+    class XwaylandToplevel : public xdg_shell::Toplevel {
+        public:
+        wlr_xwayland_surface* xsurface;
+
+        XwaylandToplevel(wlr_xwayland_surface* xsurface);
+        ~XwaylandToplevel();
+
+        wlr_surface* surface() override;
+        wlr_box geometry() override;
+        const char* app_id() override;
+        const char* title() override;
+
+        void set_size(int width, int height) override;
+        void set_activated(bool activated) override;
+        void set_fullscreen(bool fullscreen) override;
+        void close() override;
+        wlr_scene_tree* create_view(wlr_scene_tree* parent) override;
+        // X11 windows also have to know their position
+        void set_position(int x, int y) override;
+
+        private:
+        friend void toplevel_associate(wl_listener*, void*);
+        friend void toplevel_dissociate(wl_listener*, void*);
+        friend void toplevel_map(wl_listener*, void*);
+        friend void toplevel_unmap(wl_listener*, void*);
+        friend void toplevel_set_title(wl_listener*, void*);
+        friend void toplevel_set_class(wl_listener*, void*);
+
+        // Surface of the window, only while it's mapped
+        wlr_scene_tree* surface_tree;
+
+        wrapper::Listener<XwaylandToplevel> destroy;
+        wrapper::Listener<XwaylandToplevel> associate;
+        wrapper::Listener<XwaylandToplevel> dissociate;
+        wrapper::Listener<XwaylandToplevel> request_configure;
+        wrapper::Listener<XwaylandToplevel> request_activate;
+        wrapper::Listener<XwaylandToplevel> request_fullscreen;
+        wrapper::Listener<XwaylandToplevel> request_move;
+        wrapper::Listener<XwaylandToplevel> request_resize;
+        wrapper::Listener<XwaylandToplevel> set_title;
+        wrapper::Listener<XwaylandToplevel> set_class;
+
+        // Only exist while the xwayland surface has a wlr_surface
+        std::optional<wrapper::Listener<XwaylandToplevel>> map;
+        std::optional<wrapper::Listener<XwaylandToplevel>> unmap;
+    };
+
+    // Override redirect window (menus, tooltips, drag icons), placed where the client asks
+    // and never focused
+    class Unmanaged {
+        public:
+        wlr_xwayland_surface* xsurface;
+        // Only while it's mapped
+        wlr_scene_tree* scene_tree;
+
+        Unmanaged(wlr_xwayland_surface* xsurface);
+
+        private:
+        friend void unmanaged_associate(wl_listener*, void*);
+        friend void unmanaged_dissociate(wl_listener*, void*);
+
+        wrapper::Listener<Unmanaged> destroy;
+        wrapper::Listener<Unmanaged> associate;
+        wrapper::Listener<Unmanaged> dissociate;
+        wrapper::Listener<Unmanaged> request_configure;
+        wrapper::Listener<Unmanaged> set_geometry;
+
+        std::optional<wrapper::Listener<Unmanaged>> map;
+        std::optional<wrapper::Listener<Unmanaged>> unmap;
+    };
+
+    // Creates the Xwayland server and sets DISPLAY for the children
+    // With lazy, the X server only gets started once a client connects to it
+    // Returns false if Xwayland couldn't be set up
+    bool start(wl_display* display, wlr_compositor* compositor, bool lazy);
+    // Before the display gets destroyed
+    void stop();
+
+    // Surface of the override redirect window at the layout coordinates, if any
+    wlr_surface* unmanaged_at(double lx, double ly, double& sx, double& sy);
+}
@@ -0,0 +1,302 @@
+#include "background.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <list>
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "build-config.h"
+#include "output.hpp"
+#include "server.hpp"
+#include "trace.hpp"
+
+#ifdef HAVE_GDK_PIXBUF
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#endif
+
+#include <drm_fourcc.h>
+
+namespace background {
+    // Premultiplied RGBA pixels of a decoded image
+    struct Image {
+        int width;
+        int height;
+        std::vector<uint8_t> data;
+    };
+
+    // Read-only wlr_buffer over the pixels of an image, to make a texture out of them
+    struct MemoryBuffer {
+        wlr_buffer base;
+        const uint8_t* data;
+    };
+
+    void memory_buffer_destroy(wlr_buffer* buffer) {
+        delete reinterpret_cast<MemoryBuffer*>(buffer);
+    }
+
+    bool memory_buffer_begin_access(wlr_buffer* buffer, uint32_t flags, void** data,
+                                    uint32_t* format, size_t* stride) {
+        if(flags & WLR_BUFFER_DATA_PTR_ACCESS_WRITE)
+            return false;
+
+        *data = const_cast<uint8_t*>(reinterpret_cast<MemoryBuffer*>(buffer)->data);
+        *format = DRM_FORMAT_ABGR8888;
+        *stride = buffer->width * 4;
+        return true;
+    }
+
+    void memory_buffer_end_access(wlr_buffer* buffer) {}
+
+    const wlr_buffer_impl memory_buffer_impl = {
+        .destroy = memory_buffer_destroy,
+        .begin_data_ptr_access = memory_buffer_begin_access,
+        .end_data_ptr_access = memory_buffer_end_access,
+    };
+
+    // Rendered backgrounds by image, mode, color and resolution, each with a lock of the cache
+    std::map<std::string, wlr_buffer*> rendered;
+    // Images being decoded, with the outputs waiting for them
+    std::map<std::string, std::list<output::Output*>> decoding;
+
+    std::string key(const config::Background& config, int width, int height) {
+        return std::format("{}\t{}\t{} {} {} {}\t{}x{}", config.image, (int)config.mode,
+                           config.color[0], config.color[1], config.color[2], config.color[3],
+                           width, height);
+    }
+
+    // Drops the rendered backgrounds that no output shows anymore
+    void prune() {
+        for(auto it = rendered.begin(); it != rendered.end();) {
+            if(it->second->n_locks == 1) {
+                wlr_buffer_unlock(it->second);
+                it = rendered.erase(it);
+            }
+            else
+                it++;
+        }
+    }
+
+    // Runs on a worker thread
+    std::optional<Image> load(const std::string& path) {
+#ifdef HAVE_GDK_PIXBUF
+        GError* error = nullptr;
+        GdkPixbuf* file = gdk_pixbuf_new_from_file(path.c_str(), &error);
+        if(!file) {
+            wlr_log(WLR_ERROR, "failed to load background %s: %s", path.c_str(), error->message);
+            g_error_free(error);
+            return std::nullopt;
+        }
+
+        // Photos are often stored rotated, with the orientation in their metadata
+        GdkPixbuf* pixbuf = gdk_pixbuf_apply_embedded_orientation(file);
+        g_object_unref(file);
+
+        Image image = { .width = gdk_pixbuf_get_width(pixbuf),
+                        .height = gdk_pixbuf_get_height(pixbuf) };
+        image.data.resize((size_t)image.width * image.height * 4);
+
+        const guchar* pixels = gdk_pixbuf_read_pixels(pixbuf);
+        int rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+        int channels = gdk_pixbuf_get_n_channels(pixbuf);
+        bool alpha = gdk_pixbuf_get_has_alpha(pixbuf);
+        for(int y = 0; y < image.height; y++) {
+            const guchar* src = pixels + (size_t)y * rowstride;
+            uint8_t* dst = image.data.data() + (size_t)y * image.width * 4;
+            for(int x = 0; x < image.width; x++, src += channels, dst += 4) {
+                uint8_t a = alpha ? src[3] : 255;
+                dst[0] = src[0] * a / 255;
+                dst[1] = src[1] * a / 255;
+                dst[2] = src[2] * a / 255;
+                dst[3] = a;
+            }
+        }
+
+        g_object_unref(pixbuf);
+        return image;
+#else
+        wlr_log(WLR_ERROR, "can't load background %s, built without gdk-pixbuf", path.c_str());
+        return std::nullopt;
+#endif
+    }
+
+    // Renders the image as the background of a width x height output
+    wlr_buffer* render(const Image& image, const config::Background& config, int width,
+                       int height) {
+        TRACE_SCOPE("background::render");
+        const wlr_drm_format* format = wlr_drm_format_set_get(
+            wlr_renderer_get_render_formats(server.renderer), DRM_FORMAT_XRGB8888);
+        if(!format) {
+            wlr_log(WLR_ERROR, "the renderer can't render backgrounds");
+            return nullptr;
+        }
+
+        wlr_buffer* buffer = wlr_allocator_create_buffer(server.allocator, width, height, format);
+        if(!buffer) {
+            wlr_log(WLR_ERROR, "failed to allocate a %dx%d background", width, height);
+            return nullptr;
+        }
+
+        MemoryBuffer* pixels = new MemoryBuffer { .data = image.data.data() };
+        wlr_buffer_init(&pixels->base, &memory_buffer_impl, image.width, image.height);
+        wlr_texture* texture = wlr_texture_from_buffer(server.renderer, &pixels->base);
+        wlr_render_pass* pass =
+            texture ? wlr_renderer_begin_buffer_pass(server.renderer, buffer, nullptr) : nullptr;
+        if(!pass) {
+            wlr_log(WLR_ERROR, "failed to render the background %s", config.image.c_str());
+            if(texture)
+                wlr_texture_destroy(texture);
+            wlr_buffer_drop(&pixels->base);
+            wlr_buffer_drop(buffer);
+            return nullptr;
+        }
+
+        wlr_render_rect_options rect = {};
+        rect.box = { .width = width, .height = height };
+        rect.color = { config.color[0], config.color[1], config.color[2], config.color[3] };
+        wlr_render_pass_add_rect(pass, &rect);
+
+        wlr_render_texture_options options = {};
+        options.texture = texture;
+        options.filter_mode = WLR_SCALE_FILTER_BILINEAR;
+
+        double scale_x = (double)width / image.width, scale_y = (double)height / image.height;
+        double scale = 1;
+        switch(config.mode) {
+            case config::BackgroundMode::STRETCH:
+                options.dst_box = { .width = width, .height = height };
+                wlr_render_pass_add_texture(pass, &options);
+                break;
+            case config::BackgroundMode::TILE:
+                for(int y = 0; y < height; y += image.height) {
+                    for(int x = 0; x < width; x += image.width) {
+                        options.dst_box = { x, y, image.width, image.height };
+                        wlr_render_pass_add_texture(pass, &options);
+                    }
+                }
+                break;
+            case config::BackgroundMode::FILL:
+            case config::BackgroundMode::FIT:
+            case config::BackgroundMode::CENTER:
+                if(config.mode == config::BackgroundMode::FILL)
+                    scale = std::max(scale_x, scale_y);
+                else if(config.mode == config::BackgroundMode::FIT)
+                    scale = std::min(scale_x, scale_y);
+
+                // Centered, parts outside the buffer get clipped
+                options.dst_box.width = std::lround(image.width * scale);
+                options.dst_box.height = std::lround(image.height * scale);
+                options.dst_box.x = (width - options.dst_box.width) / 2;
+                options.dst_box.y = (height - options.dst_box.height) / 2;
+                wlr_render_pass_add_texture(pass, &options);
+                break;
+        }
+
+        bool success = wlr_render_pass_submit(pass);
+        wlr_texture_destroy(texture);
+        wlr_buffer_drop(&pixels->base);
+        if(!success) {
+            wlr_buffer_drop(buffer);
+            return nullptr;
+        }
+
+        // The cache holds the only lock until outputs show it
+        wlr_buffer_lock(buffer);
+        wlr_buffer_drop(buffer);
+        return buffer;
+    }
+
+    void show(output::Output* output, wlr_buffer* buffer) {
+        int width, height;
+        wlr_output_effective_resolution(output->output, &width, &height);
+
+        // Scaled outputs get the buffer at their physical resolution, so it stays sharp
+        wlr_scene_buffer* node = wlr_scene_buffer_create(output->layers.shell_background, buffer);
+        wlr_scene_buffer_set_dest_size(node, width, height);
+        wlr_scene_node_lower_to_bottom(&node->node);
+        output->background = &node->node;
+    }
+
+    void decode(const std::string& path) {
+        auto image = std::make_shared<std::optional<Image>>();
+
+        server.workers.submit(
+            [path, image] {
+                TRACE_SCOPE("background::decode");
+                *image = load(path);
+            },
+            [path, image] {
+                std::list<output::Output*> waiting;
+                waiting.swap(decoding[path]);
+                decoding.erase(path);
+                if(!image->has_value())
+                    return;
+
+                // The pixels are freed once the waiting outputs have their background, new
+                // resolutions decode the image again
+                for(output::Output* output : waiting) {
+                    const config::Background& config = output->background_config.value();
+                    int width, height;
+                    wlr_output_transformed_resolution(output->output, &width, &height);
+
+                    std::string k = key(config, width, height);
+                    auto it = rendered.find(k);
+                    if(it == rendered.end()) {
+                        wlr_buffer* buffer = render(**image, config, width, height);
+                        if(!buffer)
+                            continue;
+                        it = rendered.emplace(k, buffer).first;
+                    }
+                    show(output, it->second);
+                }
+                prune();
+            });
+    }
+
+    void update(output::Output* output) {
+        remove(output);
+
+        const std::optional<config::Background>& config = output->background_config;
+        int width, height;
+        wlr_output_transformed_resolution(output->output, &width, &height);
+        // Mirrors don't show the scene
+        if(!config || !output->scene_output || width <= 0 || height <= 0) {
+            prune();
+            return;
+        }
+
+        if(config->image.empty()) {
+            wlr_output_effective_resolution(output->output, &width, &height);
+            wlr_scene_rect* rect = wlr_scene_rect_create(output->layers.shell_background, width,
+                                                         height, config->color.data());
+            wlr_scene_node_lower_to_bottom(&rect->node);
+            output->background = &rect->node;
+            prune();
+            return;
+        }
+
+        auto it = rendered.find(key(*config, width, height));
+        if(it != rendered.end()) {
+            show(output, it->second);
+            prune();
+            return;
+        }
+
+        bool started = decoding.contains(config->image);
+        decoding[config->image].push_back(output);
+        if(!started)
+            decode(config->image);
+    }
+
+    void remove(output::Output* output) {
+        for(auto& [path, waiting] : decoding) waiting.remove(output);
+
+        if(output->background) {
+            wlr_scene_node_destroy(output->background);
+            output->background = nullptr;
+        }
+    }
+}
@@ -0,0 +1,249 @@
+#include "clients.hpp"
+
+#include <algorithm>
+
+#include "config/config.hpp"
+#include "server.hpp"
+#include "util.hpp"
+
+namespace clients {
+    constexpr uint64_t SECOND = 1000 * 1000 * 1000;
+
+    std::unordered_map<wl_client*, Client*> clients;
+
+    void client_destroy(wl_listener* listener, void* data) {
+        Client* client = wl_container_of(listener, client, destroy);
+
+        // The surfaces get destroyed right after their client
+        for(Surface* surface : client->surfaces) surface->client = nullptr;
+
+        clients.erase(client->client);
+        delete client;
+    }
+
+    void new_surface(wl_listener* listener, void* data) {
+        new Surface(static_cast<wlr_surface*>(data));
+    }
+
+    // Size of the buffer, and whether the renderer has to copy it to a texture
+    uint64_t buffer_size(wlr_buffer* buffer, bool& shm) {
+        wlr_shm_attributes shm_attribs;
+        if(wlr_buffer_get_shm(buffer, &shm_attribs)) {
+            shm = true;
+            return (uint64_t)shm_attribs.stride * shm_attribs.height;
+        }
+
+        shm = false;
+        wlr_dmabuf_attributes dmabuf_attribs;
+        if(wlr_buffer_get_dmabuf(buffer, &dmabuf_attribs)) {
+            uint64_t size = 0;
+            for(int i = 0; i < dmabuf_attribs.n_planes; i++)
+                size += (uint64_t)dmabuf_attribs.stride[i] * dmabuf_attribs.height;
+            return size;
+        }
+
+        // Single pixel buffers and such
+        return 0;
+    }
+
+    uint64_t region_area(pixman_region32_t* region) {
+        int count;
+        pixman_box32_t* rects = pixman_region32_rectangles(region, &count);
+
+        uint64_t area = 0;
+        for(int i = 0; i < count; i++)
+            area += (uint64_t)(rects[i].x2 - rects[i].x1) * (rects[i].y2 - rects[i].y1);
+        return area;
+    }
+
+    void surface_commit(wl_listener* listener, void* data) {
+        Surface* surface = static_cast<wrapper::Listener<Surface>*>(listener)->container;
+        Client* client = surface->client;
+        wlr_surface* state = surface->surface;
+        if(!client)
+            return;
+
+        client->record_commit(now_ns());
+
+        if(state->current.committed & WLR_SURFACE_STATE_FRAME_CALLBACK_LIST)
+            client->frame_callbacks++;
+
+        if(!(state->current.committed & WLR_SURFACE_STATE_BUFFER))
+            return;
+
+        client->buffer_bytes -= surface->buffer_bytes;
+        surface->buffer_bytes = 0;
+
+        wlr_buffer* buffer = state->current.buffer;
+        if(buffer) {
+            bool shm;
+            surface->buffer_bytes = buffer_size(buffer, shm);
+            client->buffer_bytes += surface->buffer_bytes;
+            client->attached_bytes += surface->buffer_bytes;
+
+            if(shm) {
+                client->shm_buffers++;
+
+                // Only the damaged part gets uploaded
+                if(buffer->width > 0 && buffer->height > 0)
+                    client->upload_bytes += region_area(&state->buffer_damage) *
+                                            surface->buffer_bytes / buffer->height / buffer->width;
+            }
+            else
+                client->dmabuf_buffers++;
+        }
+
+        client->check_limits();
+    }
+
+    void surface_destroy(wl_listener* listener, void* data) {
+        delete static_cast<wrapper::Listener<Surface>*>(listener)->container;
+    }
+
+    Client::Client(wl_client* client)
+        : client(client),
+          pid(0),
+          commits(0),
+          commit_rate(0),
+          buffer_bytes(0),
+          attached_bytes(0),
+          shm_buffers(0),
+          dmabuf_buffers(0),
+          upload_bytes(0),
+          frame_callbacks(0),
+          throttled(false),
+          window_start(now_ns()),
+          window_commits(0),
+          last_frame_done(0),
+          frame_timer(nullptr),
+          frame_timer_armed(false),
+          over_commit_rate(false),
+          over_buffer_bytes(false) {
+        wl_client_get_credentials(client, &pid, nullptr, nullptr);
+
+        // Clients have no public destroy signal, so this can't be a wrapper::Listener
+        destroy.notify = client_destroy;
+        wl_client_add_destroy_listener(client, &destroy);
+
+        clients[client] = this;
+    }
+
+    Client::~Client() {
+        if(frame_timer)
+            wl_event_source_remove(frame_timer);
+    }
+
+    uint32_t Client::outstanding_configures() {
+        uint32_t count = 0;
+        for(Surface* surface : surfaces) {
+            if(wlr_xdg_surface* xdg = wlr_xdg_surface_try_from_wlr_surface(surface->surface))
+                count += wl_list_length(&xdg->configure_list);
+            else if(wlr_layer_surface_v1* layer =
+                        wlr_layer_surface_v1_try_from_wlr_surface(surface->surface))
+                count += wl_list_length(&layer->configure_list);
+        }
+
+        return count;
+    }
+
+    void Client::record_commit(uint64_t now) {
+        commits++;
+        window_commits++;
+
+        if(now - window_start < SECOND)
+            return;
+
+        // Windows can be longer than a second if the client was idle
+        commit_rate = window_commits * SECOND / (now - window_start);
+        window_start = now;
+        window_commits = 0;
+        check_limits();
+    }
+
+    void Client::check_limits() {
+        const config::ClientLimits& limits = conf.client_limits;
+
+        bool over_rate = limits.commit_rate && commit_rate > limits.commit_rate;
+        if(over_rate && !over_commit_rate)
+            wlr_log(WLR_INFO, "client %d commits at %u Hz (limit %u Hz)%s", pid, commit_rate,
+                    limits.commit_rate, limits.throttle ? ", throttling it" : "");
+        over_commit_rate = over_rate;
+
+        // Throttling caps the rate at the limit, so it's only lifted once the client calms down
+        if(over_rate && limits.throttle)
+            throttled = true;
+        else if(!limits.throttle || !limits.commit_rate || commit_rate < limits.commit_rate / 2)
+            throttled = false;
+
+        bool over_bytes = limits.buffer_bytes && buffer_bytes > limits.buffer_bytes;
+        if(over_bytes && !over_buffer_bytes)
+            wlr_log(WLR_INFO, "client %d holds %.1f MiB of buffers (limit %.1f MiB)", pid,
+                    buffer_bytes / 1048576.0, limits.buffer_bytes / 1048576.0);
+        over_buffer_bytes = over_bytes;
+    }
+
+    Surface::Surface(wlr_surface* surface)
+        : surface(surface),
+          client(nullptr),
+          buffer_bytes(0),
+
+          commit(this, surface_commit, &surface->events.commit),
+          destroy(this, surface_destroy, &surface->events.destroy) {
+        wl_client* owner = wl_resource_get_client(surface->resource);
+
+        auto it = clients.find(owner);
+        client = it != clients.end() ? it->second : new Client(owner);
+        client->surfaces.push_back(this);
+    }
+
+    Surface::~Surface() {
+        if(!client)
+            return;
+
+        client->buffer_bytes -= buffer_bytes;
+        client->surfaces.remove(this);
+    }
+
+    // Asks the outputs of the client's surfaces for the frame its frame done was held for
+    int frame_timeout(void* data) {
+        Client* client = static_cast<Client*>(data);
+        client->frame_timer_armed = false;
+
+        for(Surface* surface : client->surfaces) {
+            wlr_surface_output* surface_output;
+            wl_list_for_each(surface_output, &surface->surface->current_outputs, link) {
+                wlr_output_schedule_frame(surface_output->output);
+            }
+        }
+        return 0;
+    }
+
+    bool send_frame_done(wlr_surface* surface, uint64_t now) {
+        auto it = clients.find(wl_resource_get_client(surface->resource));
+        if(it == clients.end() || !it->second->throttled || !conf.client_limits.commit_rate)
+            return true;
+
+        Client* client = it->second;
+        // All the surfaces of the client get it in the same frame
+        uint64_t interval = SECOND / conf.client_limits.commit_rate;
+        if(client->last_frame_done != now && now - client->last_frame_done < interval) {
+            if(!client->frame_timer_armed) {
+                if(!client->frame_timer)
+                    client->frame_timer = wl_event_loop_add_timer(
+                        wl_display_get_event_loop(server.display), frame_timeout, client);
+
+                // Rounded up, a frame that comes too early would hold it back again
+                uint64_t wait = client->last_frame_done + interval - now;
+                if(client->frame_timer) {
+                    wl_event_source_timer_update(client->frame_timer,
+                                                 std::max<int>((wait + 999999) / 1000000, 1));
+                    client->frame_timer_armed = true;
+                }
+            }
+            return false;
+        }
+
+        client->last_frame_done = now;
+        return true;
+    }
+}
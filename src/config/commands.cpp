@@ -1,15 +1,15 @@
 #include "config/commands.hpp"
 
-#include <unistd.h>
-
+#include <algorithm>
 #include <cassert>
-#include <regex>
+#include <charconv>
 
 #include "config/config.hpp"
 #include "server.hpp"
+#include "watchdog.hpp"
 #include "wlr.hpp"
 
-commands::Command* parse_command(std::string name, int line, std::vector<std::string> args) {
+commands::Command* parse_command(std::string_view name, int line, commands::Args args) {
     if(name == "set")
         return commands::SetCommand::parse(line, args);
     else if(name == "env")
@@ -18,8 +18,11 @@ commands::Command* parse_command(std::string name, int line, std::vector<std::st
         return commands::ExecCommand::parse(line, args);
     else if(name == "exec_always")
         return commands::ExecAlwaysCommand::parse(line, args);
-    else if(name == "output")
+    else if(name == "output") {
+        if(args.size() && (args[0] == "create" || args[0] == "destroy"))
+            return commands::HeadlessOutputCommand::parse(line, args);
         return commands::OutputCommand::parse(line, args);
+    }
     else if(name == "bind")
         return commands::BindCommand::parse(line, args);
     else if(name == "terminate")
@@ -34,65 +37,152 @@ commands::Command* parse_command(std::string name, int line, std::vector<std::st
         return commands::FullscreenCommand::parse(line, args);
     else if(name == "debug")
         return commands::DebugCommand::parse(line, args);
+    else if(name == "watchdog_budget")
+        return commands::WatchdogBudgetCommand::parse(line, args);
+    else if(name == "client_limit")
+        return commands::ClientLimitCommand::parse(line, args);
+    else if(name == "focus_boost")
+        return commands::FocusBoostCommand::parse(line, args);
+    else if(name == "xwayland")
+        return commands::XwaylandCommand::parse(line, args);
     else {
-        wlr_log(WLR_ERROR, "Error on line %d: command '%s' not recognized", line, name.c_str());
+        wlr_log(WLR_ERROR, "Error on line %d: command '%.*s' not recognized", line,
+                (int)name.size(), name.data());
         return nullptr;
     }
 }
 
-std::vector<commands::Command*> parse(int line, std::string name, std::vector<std::string> args,
-                                      std::optional<std::vector<std::vector<std::string>>> block) {
-    if(!block.has_value())
-        return { parse_command(name, line, args) };
+namespace commands {
+    // Source of generations and epochs, shared so they never collide between tables
+    uint64_t next_generation = 1;
+
+    VarTable::VarTable()
+        : generation(next_generation++),
+          epoch(next_generation++) {}
+
+    size_t VarTable::slot(const std::string& name) {
+        auto it = slots.find(name);
+        if(it != slots.end())
+            return it->second;
+
+        slots.emplace(name, values.size());
+        values.emplace_back();
+        return values.size() - 1;
+    }
+
+    const std::string& VarTable::get(size_t slot) const {
+        return values[slot];
+    }
+
+    void VarTable::set(const std::string& name, std::string value) {
+        std::string& current = values[slot(name)];
+        if(current == value)
+            return;
+
+        current = std::move(value);
+        generation = next_generation++;
+    }
+
+    size_t VarTable::count_changes(const VarTable& other) const {
+        size_t changes = 0;
+        for(const auto& [name, index] : slots) {
+            auto it = other.slots.find(name);
+            if(it == other.slots.end() ? !values[index].empty()
+                                       : values[index] != other.values[it->second])
+                changes++;
+        }
 
-    std::vector<commands::Command*> commands;
-    for(const auto& subcommand : block.value()) {
-        // Slow af, but who cares
-        std::vector<std::string> new_args = args;
-        for(auto& arg : subcommand) {
-            new_args.push_back(arg);
+        // Variables that only exist in the other table
+        for(const auto& [name, index] : other.slots) {
+            if(slots.find(name) == slots.end() && !other.values[index].empty())
+                changes++;
         }
-        commands.push_back(parse_command(name, ++line, new_args));
+
+        return changes;
     }
 
-    return commands;
-}
+    void VarTable::clear() {
+        slots.clear();
+        values.clear();
+        generation = next_generation++;
+        epoch = next_generation++;
+    }
 
-namespace commands {
-    std::string ParsableContent::str(std::unordered_map<std::string, std::string>& envs) {
-        std::string result;
-        std::string currentVar;
-        bool inVariable = false;
-
-        for(size_t i = 0; i < content.size(); i++) {
-            char c = content[i];
-
-            if(inVariable) {
-                if(std::isalnum(c))
-                    currentVar += c;
-                else {
-                    result += envs[currentVar] + c;
-                    currentVar.clear();
-                    if(c != '$')
-                        inVariable = false;
-                }
-            }
-            else if(c == '$') {
-                inVariable = true;
-                currentVar.clear();
-            }
+    const std::string& ParsableContent::str(VarTable& vars) {
+        if(compiled_epoch != vars.epoch)
+            compile(vars);
+        else if(expanded_generation == vars.generation)
+            return expanded;
+
+        size_t size = 0;
+        for(const auto& segment : segments)
+            size += segment.slot == LITERAL ? segment.length : vars.get(segment.slot).size();
+
+        expanded.clear();
+        expanded.reserve(size);
+        for(const auto& segment : segments) {
+            if(segment.slot == LITERAL)
+                expanded.append(content, segment.offset, segment.length);
             else
-                result += c;
+                expanded += vars.get(segment.slot);
         }
 
-        if(inVariable)
-            result += envs[currentVar];
+        expanded_generation = vars.generation;
+        return expanded;
+    }
 
-        return result;
+    void ParsableContent::compile(VarTable& vars) {
+        segments.clear();
+
+        size_t i = 0;
+        while(i < content.size()) {
+            size_t start = i;
+            if(content[i] != '$') {
+                while(i < content.size() && content[i] != '$') i++;
+                segments.push_back({ start, i - start, LITERAL });
+                continue;
+            }
+
+            // Skip the '$'
+            start = ++i;
+            while(i < content.size() && std::isalnum(static_cast<unsigned char>(content[i]))) i++;
+            segments.push_back({ start, i - start, vars.slot(content.substr(start, i - start)) });
+        }
+
+        compiled_epoch = vars.epoch;
+        // Slots may have been created, so the old expansion can't be trusted
+        expanded_generation = 0;
     }
 
     ParsableContent::ParsableContent(std::string content)
-        : content(content) {}
+        : content(content),
+          compiled_epoch(0),
+          expanded_generation(0) {}
+
+    // Joins the arguments with single spaces
+    std::string join(Args args) {
+        std::string result;
+        for(size_t i = 0; i < args.size(); i++) {
+            if(i)
+                result += ' ';
+            result += args[i];
+        }
+        return result;
+    }
+
+    bool is_number(std::string_view s) {
+        return !s.empty() && std::find_if(s.begin(), s.end(), [](unsigned char c) {
+                                 return !std::isdigit(c);
+                             }) == s.end();
+    }
+
+    // Parses the whole string as a number, fails if there's anything else in it
+    template <typename T>
+    bool to_number(std::string_view s, T& val) {
+        const char* end = s.data() + s.size();
+        auto [ptr, ec] = std::from_chars(s.data(), end, val);
+        return !s.empty() && ec == std::errc() && ptr == end;
+    }
 
     Command::Command(int line, CommandType type, bool subcommand_only)
         : line(line),
@@ -104,28 +194,25 @@ namespace commands {
           name(name),
           content(content) {}
 
-    SetCommand* SetCommand::parse(int line, std::vector<std::string> args) {
+    SetCommand* SetCommand::parse(int line, Args args) {
         if(args.size() == 0) {
             wlr_log(WLR_ERROR, "Error on line %d: missing set argument", line);
             return nullptr;
         }
-        std::string value;
-        for(size_t i = 1; i < args.size(); i++) {
-            value += args[i] + (i == args.size() - 1 ? "" : " ");
-        }
 
-        return new SetCommand(line, args[0], ParsableContent(value));
+        return new SetCommand(line, std::string(args[0]),
+                              ParsableContent(join(args.subspan(1))));
     }
 
     bool SetCommand::subcommand_of(CommandType type) {
         return false;
     }
 
-    bool SetCommand::execute(ConfigLoadPhase phase) {
+    bool SetCommand::execute(config::Config& config, ConfigLoadPhase phase) {
         // Only set vars on config first load and reloads
         if(phase == ConfigLoadPhase::COMPOSITOR_START)
             return true;
-        conf.vars[name] = content.str(conf.vars);
+        config.vars.set(name, content.str(config.vars));
 
         return true;
     }
@@ -135,29 +222,27 @@ namespace commands {
           name(name),
           content(content) {}
 
-    EnvCommand* EnvCommand::parse(int line, std::vector<std::string> args) {
+    EnvCommand* EnvCommand::parse(int line, Args args) {
         if(args.size() == 0) {
             wlr_log(WLR_ERROR, "Error on line %d: missing env argument", line);
             return nullptr;
         }
-        std::string value;
-        for(size_t i = 1; i < args.size(); i++) {
-            value += args[i] + (i == args.size() - 1 ? "" : " ");
-        }
 
-        return new EnvCommand(line, args[0], ParsableContent(value));
+        return new EnvCommand(line, std::string(args[0]),
+                              ParsableContent(join(args.subspan(1))));
     }
 
     bool EnvCommand::subcommand_of(CommandType type) {
         return false;
     }
 
-    bool EnvCommand::execute(ConfigLoadPhase phase) {
+    bool EnvCommand::execute(config::Config& config, ConfigLoadPhase phase) {
         // Only set envs once, they don't get reloaded
         if(phase != ConfigLoadPhase::CONFIG_FIRST_LOAD)
             return true;
-        setenv(name.c_str(), content.str(conf.vars).c_str(), true);
-        conf.vars[name] = content.str(conf.vars);
+        const std::string& value = content.str(config.vars);
+        setenv(name.c_str(), value.c_str(), true);
+        config.vars.set(name, value);
         return true;
     }
 
@@ -165,35 +250,24 @@ namespace commands {
         : Command(line, CommandType::EXEC, false),
           content(content) {}
 
-    ExecCommand* ExecCommand::parse(int line, std::vector<std::string> args) {
+    ExecCommand* ExecCommand::parse(int line, Args args) {
         if(args.size() == 0) {
             wlr_log(WLR_ERROR, "Error on line %d: missing exec argument", line);
             return nullptr;
         }
-        std::string value;
-        for(size_t i = 0; i < args.size(); i++) {
-            value += args[i] + (i == args.size() - 1 ? "" : " ");
-        }
 
-        return new ExecCommand(line, ParsableContent(value));
+        return new ExecCommand(line, ParsableContent(join(args)));
     }
 
     bool ExecCommand::subcommand_of(CommandType type) {
         return type == CommandType::BIND;
     }
 
-    bool ExecCommand::execute(ConfigLoadPhase phase) {
+    bool ExecCommand::execute(config::Config& config, ConfigLoadPhase phase) {
         // execs only get executed on first start
         if(phase != ConfigLoadPhase::COMPOSITOR_START && phase != ConfigLoadPhase::BIND)
             return true;
-        int pid = fork();
-        if(pid < 0) {
-            wlr_log(WLR_ERROR, "fork() failed - exiting to avoid errors");
-            exit(EXIT_FAILURE);
-        }
-
-        if(pid == 0)
-            execl("/bin/sh", "/bin/sh", "-c", content.str(conf.vars).c_str(), (void*)nullptr);
+        server.launcher.spawn(content.str(config.vars));
         return true;
     }
 
@@ -201,35 +275,30 @@ namespace commands {
         : Command(line, CommandType::EXEC_ALWAYS, false),
           content(content) {}
 
-    ExecAlwaysCommand* ExecAlwaysCommand::parse(int line, std::vector<std::string> args) {
+    ExecAlwaysCommand* ExecAlwaysCommand::parse(int line, Args args) {
         if(args.size() == 0) {
             wlr_log(WLR_ERROR, "Error on line %d: missing exec_always argument", line);
             return nullptr;
         }
-        std::string value;
-        for(size_t i = 0; i < args.size(); i++) {
-            value += args[i] + (i == args.size() - 1 ? "" : " ");
-        }
 
-        return new ExecAlwaysCommand(line, ParsableContent(value));
+        return new ExecAlwaysCommand(line, ParsableContent(join(args)));
     }
 
     bool ExecAlwaysCommand::subcommand_of(CommandType type) {
         return false;
     }
 
-    bool ExecAlwaysCommand::execute(ConfigLoadPhase phase) {
+    bool ExecAlwaysCommand::execute(config::Config& config, ConfigLoadPhase phase) {
         if(phase == ConfigLoadPhase::CONFIG_FIRST_LOAD)
             return true;
 
-        int pid = fork();
-        if(pid < 0) {
-            wlr_log(WLR_ERROR, "fork() failed - exiting to avoid errors");
-            exit(EXIT_FAILURE);
-        }
-
-        if(pid == 0)
-            execl("/bin/sh", "/bin/sh", "-c", content.str(conf.vars).c_str(), (void*)nullptr);
+        const std::string& command = content.str(config.vars);
+        // On reloads the daemon is only restarted if the command changed, which
+        // is decided by Config::reload() once the whole new config is known
+        if(phase == ConfigLoadPhase::RELOAD)
+            config.daemons.push_back({ command, -1 });
+        else
+            config.daemons.push_back({ command, server.launcher.spawn(command) });
 
         return true;
     }
@@ -237,7 +306,11 @@ namespace commands {
     OutputCommand::OutputCommand(int line, ParsableContent output_name, std::optional<bool> enabled,
                                  std::optional<Mode> mode, std::optional<Position> position,
                                  std::optional<wl_output_transform> transform,
-                                 std::optional<double> scale, std::optional<bool> adaptive_sync)
+                                 std::optional<double> scale, std::optional<bool> adaptive_sync,
+                                 std::optional<ParsableContent> mirror,
+                                 std::optional<ParsableContent> group,
+                                 std::optional<std::pair<ParsableContent, config::BackgroundMode>>
+                                     background)
         : Command(line, CommandType::OUTPUT, false),
           output_name(output_name),
           enabled(enabled),
@@ -245,33 +318,77 @@ namespace commands {
           position(position),
           transform(transform),
           scale(scale),
-          adaptive_sync(adaptive_sync) {}
+          adaptive_sync(adaptive_sync),
+          mirror(mirror),
+          group(group),
+          background(background) {}
 
-    bool is_number(const std::string& s) {
-        return !s.empty() && std::find_if(s.begin(), s.end(), [](unsigned char c) {
-                                 return !std::isdigit(c);
-                             }) == s.end();
+    // Parses <width>x<height>[@<rate>Hz]
+    std::optional<Mode> parse_mode(std::string_view s) {
+        Mode mode { .width = 0, .height = 0, .refresh_rate = 60 };
+
+        size_t x = s.find('x');
+        if(x == std::string_view::npos || !to_number(s.substr(0, x), mode.width))
+            return std::nullopt;
+        s.remove_prefix(x + 1);
+
+        size_t at = s.find('@');
+        if(!to_number(s.substr(0, at), mode.height))
+            return std::nullopt;
+        if(at == std::string_view::npos)
+            return mode;
+        s.remove_prefix(at + 1);
+
+        if(!s.ends_with("Hz") || !to_number(s.substr(0, s.size() - 2), mode.refresh_rate))
+            return std::nullopt;
+        return mode;
+    }
+
+    // Parses #rrggbb or #rrggbbaa into premultiplied RGBA
+    std::optional<std::array<float, 4>> parse_color(std::string_view s) {
+        if(!s.starts_with('#') || (s.size() != 7 && s.size() != 9))
+            return std::nullopt;
+
+        std::array<float, 4> color = { 0, 0, 0, 1 };
+        for(size_t i = 0; i * 2 + 1 < s.size(); i++) {
+            unsigned value;
+            auto [end, err] = std::from_chars(&s[i * 2 + 1], &s[i * 2 + 3], value, 16);
+            if(err != std::errc() || end != &s[i * 2 + 3])
+                return std::nullopt;
+            color[i] = value / 255.f;
+        }
+
+        for(size_t i = 0; i < 3; i++) color[i] *= color[3];
+        return color;
     }
 
-    bool is_double_number(const std::string& s) {
-        char* end = nullptr;
-        double val = strtod(s.c_str(), &end);
-        return end != s.c_str() && *end == '\0' && val != HUGE_VAL;
+    std::optional<config::BackgroundMode> parse_background_mode(std::string_view s) {
+        if(s == "stretch")
+            return config::BackgroundMode::STRETCH;
+        else if(s == "fill")
+            return config::BackgroundMode::FILL;
+        else if(s == "fit")
+            return config::BackgroundMode::FIT;
+        else if(s == "center")
+            return config::BackgroundMode::CENTER;
+        else if(s == "tile")
+            return config::BackgroundMode::TILE;
+        return std::nullopt;
     }
 
-    OutputCommand* OutputCommand::parse(int line, std::vector<std::string> args) {
+    OutputCommand* OutputCommand::parse(int line, Args args) {
         if(args.size() <= 2) {
             if(args.size() == 0)
                 wlr_log(WLR_ERROR, "Error on line %d: missing output name", line);
             else if(args.size() == 1)
                 wlr_log(WLR_ERROR, "Error on line %d: missing output subcommand", line);
             else if(args.size() == 2)
-                wlr_log(WLR_ERROR, "Error on line %d: missing argument to %s subcommand", line,
-                        args[1].c_str());
+                wlr_log(WLR_ERROR, "Error on line %d: missing argument to %.*s subcommand", line,
+                        (int)args[1].size(), args[1].data());
             return nullptr;
         }
 
-        std::smatch m;
+        ParsableContent name { std::string(args[0]) };
 
         if(args[1] == "enable") {
             if(args.size() > 3) {
@@ -280,10 +397,10 @@ namespace commands {
             }
 
             if(args[2] == "on")
-                return new OutputCommand(line, args[0], true);
+                return new OutputCommand(line, name, true);
 
             else if(args[2] == "off")
-                return new OutputCommand(line, args[0], false);
+                return new OutputCommand(line, name, false);
             else {
                 wlr_log(WLR_ERROR, "Error on line %d: invalid enable argument", line);
                 return nullptr;
@@ -295,20 +412,9 @@ namespace commands {
                 return nullptr;
             }
 
-            std::regex re("(\\d+)x(\\d+)(@(\\d+(\\.\\d+)?)Hz)?");
-            if(std::regex_match(args[2], m, re)) {
-                int width = stoi(m[1]);
-                int height = stoi(m[2]);
-                double refresh;
-                try {
-                    refresh = stod(m[4]);
-                }
-                catch(std::runtime_error& e) {
-                    refresh = 60;
-                }
-                Mode mode { .width = width, .height = height, .refresh_rate = refresh };
-                return new OutputCommand(line, args[0], std::nullopt, mode);
-            }
+            std::optional<Mode> mode = parse_mode(args[2]);
+            if(mode.has_value())
+                return new OutputCommand(line, name, std::nullopt, mode);
             else {
                 wlr_log(WLR_ERROR, "Error on line %d: invalid mode argument", line);
                 return nullptr;
@@ -320,10 +426,10 @@ namespace commands {
                 return nullptr;
             }
 
-            if(is_number(args[2]) && is_number(args[3])) {
-                Position pos { .x = stoi(args[2]), .y = stoi(args[3]) };
-                return new OutputCommand(line, args[0], std::nullopt, std::nullopt, pos);
-            }
+            Position pos;
+            if(args.size() == 4 && is_number(args[2]) && is_number(args[3]) &&
+               to_number(args[2], pos.x) && to_number(args[3], pos.y))
+                return new OutputCommand(line, name, std::nullopt, std::nullopt, pos);
             else {
                 wlr_log(WLR_ERROR, "Error on line %d: invalid position argument", line);
                 return nullptr;
@@ -357,7 +463,7 @@ namespace commands {
                 return nullptr;
             }
 
-            return new OutputCommand(line, args[0], std::nullopt, std::nullopt, std::nullopt,
+            return new OutputCommand(line, name, std::nullopt, std::nullopt, std::nullopt,
                                      transform);
         }
         else if(args[1] == "scale") {
@@ -366,9 +472,14 @@ namespace commands {
                 return nullptr;
             }
 
-            if(is_double_number(args[2]))
-                return new OutputCommand(line, args[0], std::nullopt, std::nullopt, std::nullopt,
-                                         std::nullopt, stod(args[2]));
+            double scale;
+            if(to_number(args[2], scale))
+                return new OutputCommand(line, name, std::nullopt, std::nullopt, std::nullopt,
+                                         std::nullopt, scale);
+            else {
+                wlr_log(WLR_ERROR, "Error on line %d: invalid scale argument", line);
+                return nullptr;
+            }
         }
         else if(args[1] == "adaptive_sync") {
             if(args.size() > 3) {
@@ -377,19 +488,59 @@ namespace commands {
             }
 
             if(args[2] == "on")
-                return new OutputCommand(line, args[0], std::nullopt, std::nullopt, std::nullopt,
+                return new OutputCommand(line, name, std::nullopt, std::nullopt, std::nullopt,
                                          std::nullopt, std::nullopt, true);
             else if(args[2] == "off")
-                return new OutputCommand(line, args[0], std::nullopt, std::nullopt, std::nullopt,
+                return new OutputCommand(line, name, std::nullopt, std::nullopt, std::nullopt,
                                          std::nullopt, std::nullopt, false);
             else {
                 wlr_log(WLR_ERROR, "Error on line %d: invalid adaptive_sync argument", line);
                 return nullptr;
             }
         }
+        else if(args[1] == "mirror") {
+            if(args.size() > 3) {
+                wlr_log(WLR_ERROR, "Error on line %d: too many arguments", line);
+                return nullptr;
+            }
+
+            return new OutputCommand(line, name, std::nullopt, std::nullopt, std::nullopt,
+                                     std::nullopt, std::nullopt, std::nullopt,
+                                     ParsableContent(std::string(args[2])));
+        }
+        else if(args[1] == "background") {
+            if(args.size() > 4) {
+                wlr_log(WLR_ERROR, "Error on line %d: too many arguments", line);
+                return nullptr;
+            }
+
+            // Colors are checked once variables are expanded
+            std::optional<config::BackgroundMode> mode = config::BackgroundMode::FILL;
+            if(args.size() == 4)
+                mode = parse_background_mode(args[3]);
+            if(!mode.has_value()) {
+                wlr_log(WLR_ERROR, "Error on line %d: invalid background mode", line);
+                return nullptr;
+            }
+
+            return new OutputCommand(
+                line, name, std::nullopt, std::nullopt, std::nullopt, std::nullopt,
+                std::nullopt, std::nullopt, std::nullopt, std::nullopt,
+                std::make_pair(ParsableContent(std::string(args[2])), mode.value()));
+        }
+        else if(args[1] == "group") {
+            if(args.size() > 3) {
+                wlr_log(WLR_ERROR, "Error on line %d: too many arguments", line);
+                return nullptr;
+            }
 
-        wlr_log(WLR_ERROR, "Error on line %d: unrecognized output subcommand '%s'", line,
-                args[1].c_str());
+            return new OutputCommand(line, name, std::nullopt, std::nullopt, std::nullopt,
+                                     std::nullopt, std::nullopt, std::nullopt, std::nullopt,
+                                     ParsableContent(std::string(args[2])));
+        }
+
+        wlr_log(WLR_ERROR, "Error on line %d: unrecognized output subcommand '%.*s'", line,
+                (int)args[1].size(), args[1].data());
         return nullptr;
     }
 
@@ -397,25 +548,95 @@ namespace commands {
         return false;
     }
 
-    bool OutputCommand::execute(ConfigLoadPhase phase) {
+    bool OutputCommand::execute(config::Config& config, ConfigLoadPhase phase) {
         if(phase != ConfigLoadPhase::CONFIG_FIRST_LOAD && phase != ConfigLoadPhase::RELOAD)
             return true;
 
-        std::string name = output_name.str(conf.vars);
-        config::OutputConfig& config = conf.output_config[name];
+        config::OutputConfig& output_config =
+            config.output_config[output_name.str(config.vars)];
 
         if(enabled.has_value())
-            config.enabled = enabled.value();
+            output_config.enabled = enabled.value();
         else if(mode.has_value())
-            config.mode = mode.value();
+            output_config.mode = mode.value();
         else if(position.has_value())
-            config.pos = position.value();
+            output_config.pos = position.value();
         else if(transform.has_value())
-            config.transform = transform.value();
+            output_config.transform = transform.value();
         else if(scale.has_value())
-            config.scale = scale.value();
+            output_config.scale = scale.value();
         else if(adaptive_sync.has_value())
-            config.adaptive_sync = adaptive_sync.value();
+            output_config.adaptive_sync = adaptive_sync.value();
+        else if(mirror.has_value())
+            output_config.mirror = mirror->str(config.vars);
+        else if(group.has_value())
+            output_config.group = group->str(config.vars);
+        else if(background.has_value()) {
+            std::string value = background->first.str(config.vars);
+            if(value.starts_with('#')) {
+                std::optional<std::array<float, 4>> color = parse_color(value);
+                if(!color.has_value()) {
+                    wlr_log(WLR_ERROR, "Error on line %d: invalid background color", line);
+                    return true;
+                }
+                output_config.background = config::Background { "", background->second, *color };
+            }
+            else {
+                if(value.starts_with("~/") && getenv("HOME"))
+                    value = getenv("HOME") + value.substr(1);
+                output_config.background =
+                    config::Background { value, background->second, { 0, 0, 0, 1 } };
+            }
+        }
+
+        return true;
+    }
+
+    HeadlessOutputCommand::HeadlessOutputCommand(int line, std::optional<Mode> mode,
+                                                 std::optional<ParsableContent> output_name)
+        : Command(line, CommandType::HEADLESS_OUTPUT, false),
+          mode(mode),
+          output_name(output_name) {}
+
+    HeadlessOutputCommand* HeadlessOutputCommand::parse(int line, Args args) {
+        if(args[0] == "create") {
+            if(args.size() != 3 || args[1] != "headless") {
+                wlr_log(WLR_ERROR,
+                        "Error on line %d: expected 'output create headless <width>x<height>'",
+                        line);
+                return nullptr;
+            }
+
+            std::optional<Mode> mode = parse_mode(args[2]);
+            if(!mode.has_value() || mode->width <= 0 || mode->height <= 0 ||
+               mode->refresh_rate <= 0) {
+                wlr_log(WLR_ERROR, "Error on line %d: invalid mode argument", line);
+                return nullptr;
+            }
+            return new HeadlessOutputCommand(line, mode, std::nullopt);
+        }
+
+        if(args.size() != 2) {
+            wlr_log(WLR_ERROR, "Error on line %d: expected 'output destroy <name>'", line);
+            return nullptr;
+        }
+        return new HeadlessOutputCommand(line, std::nullopt,
+                                         ParsableContent(std::string(args[1])));
+    }
+
+    bool HeadlessOutputCommand::subcommand_of(CommandType type) {
+        return type == CommandType::BIND;
+    }
+
+    bool HeadlessOutputCommand::execute(config::Config& config, ConfigLoadPhase phase) {
+        // Not on reloads, which would create the outputs again
+        if(phase != ConfigLoadPhase::COMPOSITOR_START && phase != ConfigLoadPhase::BIND)
+            return true;
+
+        if(mode.has_value())
+            server.output_manager.create_headless(mode.value());
+        else
+            server.output_manager.destroy_headless(output_name->str(config.vars));
 
         return true;
     }
@@ -429,7 +650,7 @@ namespace commands {
         delete command;
     }
 
-    BindCommand* BindCommand::parse(int line, std::vector<std::string> args) {
+    BindCommand* BindCommand::parse(int line, Args args) {
         if(args.size() < 2) {
             if(args.size() == 0)
                 wlr_log(WLR_ERROR, "Error on line %d: missing keybind argument", line);
@@ -438,11 +659,7 @@ namespace commands {
             return nullptr;
         }
 
-        std::string keybind = args[0];
-        std::string name = args[1];
-        args.erase(args.begin());
-        args.erase(args.begin());
-        Command* command = ::parse_command(name, line, args);
+        Command* command = ::parse_command(args[1], line, args.subspan(2));
 
         if(!command)
             return nullptr;
@@ -454,27 +671,28 @@ namespace commands {
             return nullptr;
         }
 
-        return new BindCommand(line, ParsableContent(keybind), command);
+        return new BindCommand(line, ParsableContent(std::string(args[0])), command);
     }
 
     bool BindCommand::subcommand_of(CommandType type) {
         return false;
     }
 
-    bool BindCommand::execute(ConfigLoadPhase phase) {
+    bool BindCommand::execute(config::Config& config, ConfigLoadPhase phase) {
         if(phase != ConfigLoadPhase::COMPOSITOR_START && phase != ConfigLoadPhase::RELOAD)
             return true;
 
-        std::optional<config::Bind> bind = config::Bind::from_str(line, keybind.str(conf.vars));
+        std::optional<config::Bind> bind =
+            config::Bind::from_str(line, keybind.str(config.vars));
         if(bind.has_value())
-            conf.binds.push_back({ bind.value(), command });
+            config.binds.push_back({ bind.value(), command });
         return true;
     }
 
     TerminateCommand::TerminateCommand(int line)
         : Command(line, CommandType::TERMINATE, true) {}
 
-    TerminateCommand* TerminateCommand::parse(int line, std::vector<std::string> args) {
+    TerminateCommand* TerminateCommand::parse(int line, Args args) {
         if(args.size()) {
             wlr_log(WLR_ERROR, "Error on line %d: too many arguments", line);
             return nullptr;
@@ -487,8 +705,8 @@ namespace commands {
         return type == CommandType::BIND;
     }
 
-    bool TerminateCommand::execute(ConfigLoadPhase phase) {
-        wl_display_terminate(server.display);
+    bool TerminateCommand::execute(config::Config& config, ConfigLoadPhase phase) {
+        watchdog::terminate(server.display);
         // Shouldn't even be reached
         return false;
     }
@@ -496,7 +714,7 @@ namespace commands {
     ReloadCommand::ReloadCommand(int line)
         : Command(line, CommandType::RELOAD, true) {}
 
-    ReloadCommand* ReloadCommand::parse(int line, std::vector<std::string> args) {
+    ReloadCommand* ReloadCommand::parse(int line, Args args) {
         if(args.size()) {
             wlr_log(WLR_ERROR, "Error on line %d: too many arguments", line);
             return nullptr;
@@ -509,13 +727,13 @@ namespace commands {
         return type == CommandType::BIND;
     }
 
-    bool ReloadCommand::execute(ConfigLoadPhase phase) {
+    bool ReloadCommand::execute(config::Config& config, ConfigLoadPhase phase) {
         if(phase != ConfigLoadPhase::BIND)
             return true;
 
-        conf.clear();
-        conf.load();
-        conf.execute_phase(ConfigLoadPhase::RELOAD);
+        // This command is owned by the running config, which gets replaced once
+        // the worker reading the new one is done
+        config.reload();
 
         return false;
     }
@@ -523,7 +741,7 @@ namespace commands {
     KillCommand::KillCommand(int line)
         : Command(line, CommandType::KILL, true) {}
 
-    KillCommand* KillCommand::parse(int line, std::vector<std::string> args) {
+    KillCommand* KillCommand::parse(int line, Args args) {
         if(args.size()) {
             wlr_log(WLR_ERROR, "Error on line %d: too many arguments", line);
             return nullptr;
@@ -536,19 +754,16 @@ namespace commands {
         return type == CommandType::BIND;
     }
 
-    bool KillCommand::execute(ConfigLoadPhase phase) {
+    bool KillCommand::execute(config::Config& config, ConfigLoadPhase phase) {
         if(phase != ConfigLoadPhase::BIND)
             return true;
 
         if(server.input_manager.seat.focused_node &&
            server.input_manager.seat.focused_node->node->type == nodes::NodeType::TOPLEVEL)
-            wlr_xdg_toplevel_send_close(
-                server.input_manager.seat.focused_node->node->val.toplevel->toplevel);
+            server.input_manager.seat.focused_node->node->val.toplevel->close();
         else if(server.input_manager.seat.previous_toplevel &&
-                server.input_manager.seat.previous_toplevel->node->val.toplevel->toplevel->base
-                    ->surface->mapped)
-            wlr_xdg_toplevel_send_close(
-                server.input_manager.seat.previous_toplevel->node->val.toplevel->toplevel);
+                server.input_manager.seat.previous_toplevel->node->val.toplevel->surface()->mapped)
+            server.input_manager.seat.previous_toplevel->node->val.toplevel->close();
 
         return true;
     }
@@ -557,25 +772,29 @@ namespace commands {
         : Command(line, CommandType::WORKSPACE, true),
           id(id) {}
 
-    WorkspaceCommand* WorkspaceCommand::parse(int line, std::vector<std::string> args) {
-        if(args.size() > 1) {
-            wlr_log(WLR_ERROR, "Error on line %d: too many arguments", line);
+    WorkspaceCommand* WorkspaceCommand::parse(int line, Args args) {
+        if(args.size() != 1) {
+            if(args.size() == 0)
+                wlr_log(WLR_ERROR, "Error on line %d: missing workspace id", line);
+            else
+                wlr_log(WLR_ERROR, "Error on line %d: too many arguments", line);
             return nullptr;
         }
 
-        if(!is_number(args[0])) {
+        int id;
+        if(!is_number(args[0]) || !to_number(args[0], id)) {
             wlr_log(WLR_ERROR, "Error on line %d: workspace id is not a valid number", line);
             return nullptr;
         }
 
-        return new WorkspaceCommand(line, stoi(args[0]));
+        return new WorkspaceCommand(line, id);
     }
 
     bool WorkspaceCommand::subcommand_of(CommandType type) {
         return type == CommandType::BIND;
     }
 
-    bool WorkspaceCommand::execute(ConfigLoadPhase phase) {
+    bool WorkspaceCommand::execute(config::Config& config, ConfigLoadPhase phase) {
         if(phase != ConfigLoadPhase::BIND)
             return true;
 
@@ -587,7 +806,7 @@ namespace commands {
     FullscreenCommand::FullscreenCommand(int line)
         : Command(line, CommandType::FULLSCREEN, true) {}
 
-    FullscreenCommand* FullscreenCommand::parse(int line, std::vector<std::string> args) {
+    FullscreenCommand* FullscreenCommand::parse(int line, Args args) {
         if(args.size()) {
             wlr_log(WLR_ERROR, "Error on line %d: missing exec argument", line);
             return nullptr;
@@ -600,7 +819,7 @@ namespace commands {
         return type == CommandType::BIND;
     }
 
-    bool FullscreenCommand::execute(ConfigLoadPhase phase) {
+    bool FullscreenCommand::execute(config::Config& config, ConfigLoadPhase phase) {
         if(phase != ConfigLoadPhase::BIND)
             return true;
 
@@ -611,297 +830,223 @@ namespace commands {
         return true;
     }
 
-    DebugCommand::DebugCommand(int line)
-        : Command(line, CommandType::DEBUG, true) {}
+    WatchdogBudgetCommand::WatchdogBudgetCommand(int line, uint64_t budget)
+        : Command(line, CommandType::WATCHDOG_BUDGET, false),
+          budget(budget) {}
 
-    DebugCommand* DebugCommand::parse(int line, std::vector<std::string> args) {
-        if(args.size()) {
-            wlr_log(WLR_ERROR, "Error on line %d: too many arguments", line);
+    WatchdogBudgetCommand* WatchdogBudgetCommand::parse(int line, Args args) {
+        if(args.size() != 1) {
+            if(args.size() == 0)
+                wlr_log(WLR_ERROR, "Error on line %d: missing budget", line);
+            else
+                wlr_log(WLR_ERROR, "Error on line %d: too many arguments", line);
             return nullptr;
         }
 
-        return new DebugCommand(line);
-    }
+        double ms;
+        if(!to_number(args[0], ms) || ms <= 0) {
+            wlr_log(WLR_ERROR, "Error on line %d: budget is not a valid number of milliseconds",
+                    line);
+            return nullptr;
+        }
 
-    bool DebugCommand::subcommand_of(CommandType type) {
-        return type == CommandType::BIND;
+        return new WatchdogBudgetCommand(line, ms * 1000 * 1000);
     }
 
-    bool DebugCommand::execute(ConfigLoadPhase phase) {
-        if(phase != ConfigLoadPhase::BIND)
-            return true;
+    bool WatchdogBudgetCommand::subcommand_of(CommandType type) {
+        return false;
+    }
 
-        if(wlr_backend_is_wl(server.backend)) {
-            wlr_wl_output_create(server.backend);
-            return true;
-        }
-        else if(wlr_backend_is_multi(server.backend)) {
-            bool done = false;
-            wlr_multi_for_each_backend(
-                server.backend,
-                [](wlr_backend* backend, void* data) {
-                    bool* done = static_cast<bool*>(data);
-                    if(!*done && wlr_backend_is_wl(backend)) {
-                        wlr_wl_output_create(backend);
-                        *done = true;
-                    }
-                },
-                &done);
+    bool WatchdogBudgetCommand::execute(config::Config& config, ConfigLoadPhase phase) {
+        if(phase != ConfigLoadPhase::CONFIG_FIRST_LOAD && phase != ConfigLoadPhase::RELOAD)
             return true;
-        }
-
-        wlr_log(WLR_ERROR, "no wayland backend found");
 
+        config.watchdog_budget = budget;
         return true;
     }
-}
-
-namespace parsing {
-    Token::Token(int line, TokenType type)
-        : line(line),
-          type(type),
-          val(std::nullopt) {}
 
-    Token::Token(int line, TokenType type, std::string val)
-        : line(line),
-          type(type),
-          val(val) {}
-
-    Lexer::Lexer(const std::string& text)
-        : text(text),
-          index(0),
-          line(1) {}
+    ClientLimitCommand::ClientLimitCommand(int line, Limit limit, uint64_t value)
+        : Command(line, CommandType::CLIENT_LIMIT, false),
+          limit(limit),
+          value(value) {}
 
-    std::vector<Token> Lexer::get_tokens() {
-        std::vector<Token> tokens;
-
-        while(1) {
-            std::optional<Token> token = read_token();
+    ClientLimitCommand* ClientLimitCommand::parse(int line, Args args) {
+        if(args.size() != 2) {
+            wlr_log(WLR_ERROR, "Error on line %d: expected a limit and its value", line);
+            return nullptr;
+        }
 
-            if(token.has_value()) {
-                tokens.push_back(token.value());
-                if(token.value().type == TokenType::NEW_LINE)
-                    line++;
+        if(args[0] == "action") {
+            if(args[1] != "log" && args[1] != "throttle") {
+                wlr_log(WLR_ERROR, "Error on line %d: action must be log or throttle", line);
+                return nullptr;
             }
+            return new ClientLimitCommand(line, Limit::ACTION, args[1] == "throttle");
+        }
 
-            if(peek() == '\0')
-                break;
+        Limit limit;
+        if(args[0] == "commit_rate")
+            limit = Limit::COMMIT_RATE;
+        else if(args[0] == "buffer_mb")
+            limit = Limit::BUFFER_MB;
+        else {
+            wlr_log(WLR_ERROR, "Error on line %d: unknown client limit '%.*s'", line,
+                    (int)args[0].size(), args[0].data());
+            return nullptr;
         }
 
-        return tokens;
-    }
+        uint64_t value;
+        if(!to_number(args[1], value)) {
+            wlr_log(WLR_ERROR, "Error on line %d: limit is not a valid number", line);
+            return nullptr;
+        }
 
-    char Lexer::consume() {
-        if(index >= text.size())
-            return '\0';
-        return text[index++];
+        return new ClientLimitCommand(line, limit, value);
     }
 
-    char Lexer::peek() {
-        if(index >= text.size())
-            return '\0';
-        return text[index];
+    bool ClientLimitCommand::subcommand_of(CommandType type) {
+        return false;
     }
 
-    std::optional<Token> Lexer::read_token() {
-        while(peek() == ' ') consume();
-        char c = peek();
-
-        if(c == '\n') {
-            consume();
-            return Token(line, TokenType::NEW_LINE);
-        }
-        else if(c == '\0') {
-            consume();
-            return Token(line, TokenType::FILE_END);
-        }
-        else if(c == '{') {
-            consume();
-            return Token(line, TokenType::BRACKET_OPEN);
-        }
-        else if(c == '}') {
-            consume();
-            return Token(line, TokenType::BRACKET_CLOSE);
-        }
-        else if(c == '#') {
-            while(peek() != '\n' && peek() != '\0') consume();
-            return std::nullopt;
-        }
-        else if(c == '"') {
-            std::optional<std::string> s = read_string();
-            if(s.has_value())
-                return Token(line, TokenType::STRING, s.value());
-            return Token(line, TokenType::UNKNOWN);
-        }
-        else
-            return Token(line, TokenType::ARG, read_word());
-    }
+    bool ClientLimitCommand::execute(config::Config& config, ConfigLoadPhase phase) {
+        if(phase != ConfigLoadPhase::CONFIG_FIRST_LOAD && phase != ConfigLoadPhase::RELOAD)
+            return true;
 
-    std::string Lexer::read_word() {
-        std::string result;
-        while(1) {
-            char c = peek();
-            if(c == '#' || c == '{') {
-                while(peek() != '\n' && peek() != '\0') consume();
+        switch(limit) {
+            case Limit::COMMIT_RATE:
+                config.client_limits.commit_rate = value;
                 break;
-            }
-
-            while(peek() == ' ') consume();
-            if(c == '\0' || c == '\n' || c == ' ')
+            case Limit::BUFFER_MB:
+                config.client_limits.buffer_bytes = value * 1024 * 1024;
+                break;
+            case Limit::ACTION:
+                config.client_limits.throttle = value;
                 break;
-
-            consume();
-            result += c;
         }
 
-        return result;
+        return true;
     }
 
-    std::optional<std::string> Lexer::read_string() {
-        std::string result;
-        consume();
+    // More than that and a runaway focused client could starve the compositor
+    constexpr int MAX_FOCUS_BOOST = 10;
 
-        while(1) {
-            char c = peek();
-            if(c == '"')
-                break;
+    FocusBoostCommand::FocusBoostCommand(int line, int levels)
+        : Command(line, CommandType::FOCUS_BOOST, false),
+          levels(levels) {}
 
-            if(c == '\0' || c == '\n') {
-                wlr_log(WLR_ERROR, "Error on line %d: opened string is never closed", line);
-                return std::nullopt;
-            }
+    FocusBoostCommand* FocusBoostCommand::parse(int line, Args args) {
+        if(args.size() != 1) {
+            if(args.size() == 0)
+                wlr_log(WLR_ERROR, "Error on line %d: missing nice levels", line);
+            else
+                wlr_log(WLR_ERROR, "Error on line %d: too many arguments", line);
+            return nullptr;
+        }
 
-            consume();
-            result += c;
+        int levels;
+        if(!to_number(args[0], levels) || levels < 0 || levels > MAX_FOCUS_BOOST) {
+            wlr_log(WLR_ERROR, "Error on line %d: nice levels must be between 0 and %d", line,
+                    MAX_FOCUS_BOOST);
+            return nullptr;
         }
 
-        consume();
-        return result;
+        return new FocusBoostCommand(line, levels);
     }
 
-    Parser::Parser(const std::string& text)
-        : index(0) {
-        Lexer lexer(text);
-        tokens = lexer.get_tokens();
+    bool FocusBoostCommand::subcommand_of(CommandType type) {
+        return false;
     }
 
-    std::vector<commands::Command*> Parser::parse() {
-        std::vector<commands::Command*> parsed;
-
-        while(1) {
-            Token token = peek();
-            while((token = peek()).type == TokenType::NEW_LINE) {
-                token = consume();
-            }
+    bool FocusBoostCommand::execute(config::Config& config, ConfigLoadPhase phase) {
+        if(phase != ConfigLoadPhase::CONFIG_FIRST_LOAD && phase != ConfigLoadPhase::RELOAD)
+            return true;
 
-            if(token.type == TokenType::FILE_END)
-                break;
+        config.focus_boost = levels;
+        return true;
+    }
 
-            std::vector<commands::Command*> commands = read_commands();
+    XwaylandCommand::XwaylandCommand(int line, config::XwaylandMode mode)
+        : Command(line, CommandType::XWAYLAND, false),
+          mode(mode) {}
 
-            for(auto& command : commands) {
-                if(command)
-                    parsed.push_back(command);
-            }
+    XwaylandCommand* XwaylandCommand::parse(int line, Args args) {
+        if(args.size() != 1) {
+            if(args.size() == 0)
+                wlr_log(WLR_ERROR, "Error on line %d: missing xwayland mode", line);
+            else
+                wlr_log(WLR_ERROR, "Error on line %d: too many arguments", line);
+            return nullptr;
         }
 
-        return parsed;
-    }
+        config::XwaylandMode mode;
+        if(args[0] == "enable")
+            mode = config::XwaylandMode::LAZY;
+        else if(args[0] == "disable")
+            mode = config::XwaylandMode::DISABLED;
+        else if(args[0] == "force")
+            mode = config::XwaylandMode::FORCE;
+        else {
+            wlr_log(WLR_ERROR, "Error on line %d: xwayland mode must be enable, disable or force",
+                    line);
+            return nullptr;
+        }
 
-    Token Parser::consume() {
-        if(index >= tokens.size())
-            return Token(0, TokenType::FILE_END);
-        return tokens[index++];
+        return new XwaylandCommand(line, mode);
     }
 
-    Token Parser::peek() {
-        if(index >= tokens.size())
-            return Token(0, TokenType::FILE_END);
-        return tokens[index];
+    bool XwaylandCommand::subcommand_of(CommandType type) {
+        return false;
     }
 
-    std::vector<commands::Command*> Parser::read_commands() {
-        std::vector<std::string> args;
-        Token token = consume();
-
-        if(token.type != TokenType::ARG) {
-            wlr_log(WLR_ERROR, "Error on line %d: expected command", token.line);
-            return {};
-        }
+    bool XwaylandCommand::execute(config::Config& config, ConfigLoadPhase phase) {
+        if(phase != ConfigLoadPhase::CONFIG_FIRST_LOAD && phase != ConfigLoadPhase::RELOAD)
+            return true;
 
-        int line = token.line;
-        std::string name = token.val.value();
+        config.xwayland = mode;
+        return true;
+    }
 
-        while(1) {
-            Token token = peek();
+    DebugCommand::DebugCommand(int line)
+        : Command(line, CommandType::DEBUG, true) {}
 
-            if(token.type == TokenType::NEW_LINE || token.type == TokenType::BRACKET_CLOSE ||
-               token.type == TokenType::FILE_END)
-                break;
-            else if(token.type == TokenType::BRACKET_OPEN) {
-                std::vector<std::vector<std::string>> block = read_block();
-                token = consume();
-                if(token.type != TokenType::BRACKET_CLOSE) {
-                    wlr_log(WLR_ERROR, "Error on line %d: expected '}'", token.line);
-                    return {};
-                }
-                return ::parse(line, name, args, block);
-            }
-            else if(token.type == TokenType::STRING || token.type == TokenType::ARG) {
-                consume();
-                args.push_back(token.val.value());
-            }
+    DebugCommand* DebugCommand::parse(int line, Args args) {
+        if(args.size()) {
+            wlr_log(WLR_ERROR, "Error on line %d: too many arguments", line);
+            return nullptr;
         }
 
-        return ::parse(line, name, args, std::nullopt);
+        return new DebugCommand(line);
     }
 
-    std::vector<std::vector<std::string>> Parser::read_block() {
-        // Consume the opening bracket
-        Token token = consume();
-        if(token.type != TokenType::BRACKET_OPEN) {
-            wlr_log(WLR_ERROR, "Error on line %d: expected '{'", token.line);
-            return {};
-        }
-
-        std::vector<std::vector<std::string>> block;
-
-        while(1) {
-            while(peek().type == TokenType::NEW_LINE) {
-                consume();
-            }
-
-            if(peek().type == TokenType::BRACKET_CLOSE || peek().type == TokenType::FILE_END) {
-                break;
-            }
-
-            std::vector<std::string> line_args;
-            while(1) {
-                token = peek();
-
-                if(token.type == TokenType::NEW_LINE || token.type == TokenType::BRACKET_CLOSE ||
-                   token.type == TokenType::FILE_END) {
-                    break;
-                }
-                else if(token.type == TokenType::STRING || token.type == TokenType::ARG) {
-                    consume();
-                    line_args.push_back(token.val.value());
-                }
-                else {
-                    wlr_log(WLR_ERROR, "Error on line %d: unexpected token in block", token.line);
-                    consume();
-                }
-            }
+    bool DebugCommand::subcommand_of(CommandType type) {
+        return type == CommandType::BIND;
+    }
 
-            if(!line_args.empty()) {
-                block.push_back(line_args);
-            }
+    bool DebugCommand::execute(config::Config& config, ConfigLoadPhase phase) {
+        if(phase != ConfigLoadPhase::BIND)
+            return true;
 
-            if(peek().type == TokenType::NEW_LINE) {
-                consume();
-            }
+        if(wlr_backend_is_wl(server.backend)) {
+            wlr_wl_output_create(server.backend);
+            return true;
+        }
+        else if(wlr_backend_is_multi(server.backend)) {
+            bool done = false;
+            wlr_multi_for_each_backend(
+                server.backend,
+                [](wlr_backend* backend, void* data) {
+                    bool* done = static_cast<bool*>(data);
+                    if(!*done && wlr_backend_is_wl(backend)) {
+                        wlr_wl_output_create(backend);
+                        *done = true;
+                    }
+                },
+                &done);
+            return true;
         }
 
-        return block;
+        wlr_log(WLR_ERROR, "no wayland backend found");
+
+        return true;
     }
 }
@@ -5,10 +5,13 @@
 
 #include <algorithm>
 #include <cassert>
-#include <fstream>
+#include <memory>
 #include <sstream>
 
+#include "config/parser.hpp"
 #include "output.hpp"
+#include "server.hpp"
+#include "trace.hpp"
 
 config::Config conf;
 
@@ -78,7 +81,10 @@ namespace config {
           pos({ 0, 0 }),
           transform(WL_OUTPUT_TRANSFORM_NORMAL),
           scale(1.0),
-          adaptive_sync(false) {}
+          adaptive_sync(false),
+          mirror(std::nullopt),
+          group(std::nullopt),
+          background(std::nullopt) {}
 
     OutputConfig::OutputConfig(wlr_output_configuration_head_v1* config)
         : /*name(config->state.output->name),*/
@@ -112,34 +118,170 @@ namespace config {
         wordfree(&p);
     }
 
-    void Config::load() {
-        std::string text;
-        if((text = read_file()).empty())
-            return;
+    bool Config::load() {
+        if(!read())
+            return false;
+
+        import_env();
+        return true;
+    }
+
+    bool Config::read() {
+        TRACE_SCOPE("config::read");
+        if(config_path.empty())
+            default_config_path();
+
+        wlr_log(WLR_INFO, "reading config file at %s", config_path.c_str());
+        parsing::MappedFile file(config_path.c_str());
+        if(!file.valid()) {
+            wlr_log(WLR_ERROR, "failed reading config file - skipping");
+            return false;
+        }
+
+        parsing::Parser parser(file.text());
+        parser.parse();
+
+        commands.reserve(parser.statements.size());
+        for(const auto& statement : parser.statements) {
+            commands::Args words = parser.words(statement);
+            commands::Command* command =
+                parse_command(words.front(), statement.line, words.subspan(1));
+            if(command)
+                commands.push_back(command);
+        }
 
-        parsing::Parser parser(text);
-        commands = parser.parse();
+        return true;
+    }
 
+    void Config::import_env() {
         char** env = environ;
         for(; *env; ++env) {
             std::string cur(*env);
             size_t pos = cur.find('=');
-            if(pos == cur.size() || pos == 0)
+            if(pos == std::string::npos || pos == 0)
                 continue;
 
-            std::string name = cur.substr(pos);
-            std::string value = cur.substr(pos + 1, cur.size());
-            vars[name] = value;
+            vars.set(cur.substr(0, pos), cur.substr(pos + 1));
         }
     }
 
     void Config::execute_phase(ConfigLoadPhase phase) {
+        TRACE_SCOPE("config::execute_phase");
         for(auto& command : commands) {
-            if(!command->execute(phase))
+            if(!command->execute(*this, phase))
                 break;
         }
     }
 
+    void Config::reload() {
+        if(reloading) {
+            wlr_log(WLR_INFO, "config reload already in progress - skipping");
+            return;
+        }
+        reloading = true;
+
+        auto next = std::make_shared<Config>();
+        next->config_path = config_path;
+        auto read = std::make_shared<bool>(false);
+
+        server.workers.submit([next, read] { *read = next->read(); },
+                              [this, next, read] {
+                                  TRACE_SCOPE("config::reload");
+                                  reloading = false;
+                                  if(!*read) {
+                                      wlr_log(WLR_ERROR, "keeping the current config");
+                                      return;
+                                  }
+
+                                  next->import_env();
+                                  next->execute_phase(ConfigLoadPhase::RELOAD);
+                                  apply_changes(*next);
+                                  // next now holds the old state, which gets freed here
+                              });
+    }
+
+    bool has_bind(const std::vector<std::pair<Bind, commands::Command*>>& binds,
+                  const Bind& bind) {
+        return std::find_if(binds.begin(), binds.end(),
+                            [&](const auto& cur) { return cur.first == bind; }) != binds.end();
+    }
+
+    void Config::apply_changes(Config& next) {
+        // Outputs that aren't in the new config keep their current configuration,
+        // which may also have been set at runtime through wlr-output-management
+        for(const auto& [name, current] : output_config)
+            next.output_config.try_emplace(name, current);
+
+        // Only outputs with a different config get a modeset
+        size_t outputs_changed = 0;
+        for(output::Output* output : server.output_manager.outputs) {
+            auto old_config = output_config.find(output->output->name);
+            auto new_config = next.output_config.find(output->output->name);
+            if(new_config == next.output_config.end())
+                continue;
+            if(old_config != output_config.end() && old_config->second == new_config->second)
+                continue;
+
+            outputs_changed++;
+            if(!output->apply_config(&new_config->second, false))
+                wlr_log(WLR_ERROR, "failed applying the new config of output %s",
+                        output->output->name);
+            output->arrange_layers();
+            output->update_position();
+        }
+        if(outputs_changed)
+            server.root.arrange();
+
+        size_t binds_added = 0, binds_removed = 0;
+        for(const auto& [bind, command] : next.binds) {
+            if(!has_bind(binds, bind))
+                binds_added++;
+        }
+        for(const auto& [bind, command] : binds) {
+            if(!has_bind(next.binds, bind))
+                binds_removed++;
+        }
+
+        // Daemons whose command didn't change keep running, the others get restarted
+        size_t daemons_started = 0, daemons_stopped = 0;
+        for(auto& [command, pid] : next.daemons) {
+            auto old = std::find_if(daemons.begin(), daemons.end(), [&](const auto& daemon) {
+                return daemon.second >= 0 && daemon.first == command;
+            });
+
+            if(old != daemons.end() && server.launcher.running(old->second)) {
+                pid = old->second;
+                old->second = -1;
+            }
+            else {
+                pid = server.launcher.spawn(command);
+                daemons_started++;
+            }
+        }
+        for(const auto& [command, pid] : daemons) {
+            if(pid >= 0 && server.launcher.running(pid)) {
+                server.launcher.terminate(pid);
+                daemons_stopped++;
+            }
+        }
+
+        wlr_log(WLR_INFO,
+                "config reloaded: %zu outputs changed, %zu binds added, %zu binds removed, "
+                "%zu variables changed, %zu daemons started, %zu daemons stopped",
+                outputs_changed, binds_added, binds_removed, vars.count_changes(next.vars),
+                daemons_started, daemons_stopped);
+
+        std::swap(vars, next.vars);
+        std::swap(binds, next.binds);
+        std::swap(output_config, next.output_config);
+        std::swap(daemons, next.daemons);
+        std::swap(watchdog_budget, next.watchdog_budget);
+        std::swap(client_limits, next.client_limits);
+        std::swap(focus_boost, next.focus_boost);
+        std::swap(xwayland, next.xwayland);
+        std::swap(commands, next.commands);
+    }
+
     Config::~Config() {
         clear();
     }
@@ -169,28 +311,4 @@ namespace config {
 
         set_config_path(path);
     }
-
-    std::string Config::read_file() {
-        if(config_path.empty())
-            default_config_path();
-
-        wlr_log(WLR_INFO, "reading config file at %s", config_path.c_str());
-        if(access(config_path.c_str(), R_OK)) {
-            wlr_log(WLR_ERROR, "failed reading config file - skipping");
-            return "";
-        }
-
-        std::ifstream input(config_path, std::ios::binary);
-
-        if(!input.is_open()) {
-            wlr_log(WLR_ERROR, "failed reading config file - skipping");
-            return "";
-        }
-
-        std::ostringstream sstr;
-        sstr << input.rdbuf();
-        input.close();
-
-        return sstr.str();
-    }
 }
@@ -0,0 +1,248 @@
+#include "config/parser.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "wlr.hpp"
+
+namespace parsing {
+    MappedFile::MappedFile(const char* path)
+        : data(nullptr),
+          size(0),
+          ok(false) {
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            return;
+
+        struct stat st;
+        if(fstat(fd, &st) < 0) {
+            close(fd);
+            return;
+        }
+
+        // mmap() doesn't accept empty mappings, an empty file is just an empty text
+        if(st.st_size > 0) {
+            void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mapping == MAP_FAILED) {
+                close(fd);
+                return;
+            }
+
+            // The file is only read once, front to back
+            madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+            data = mapping;
+            size = st.st_size;
+        }
+
+        close(fd);
+        ok = true;
+    }
+
+    MappedFile::~MappedFile() {
+        if(data)
+            munmap(data, size);
+    }
+
+    bool MappedFile::valid() {
+        return ok;
+    }
+
+    std::string_view MappedFile::text() {
+        return std::string_view(static_cast<const char*>(data), size);
+    }
+
+    Lexer::Lexer(std::string_view text)
+        : text(text),
+          index(0),
+          line(1) {}
+
+    Token Lexer::next() {
+        while(1) {
+            char c = peek();
+            while(c == ' ' || c == '\t' || c == '\r') {
+                index++;
+                c = peek();
+            }
+
+            switch(c) {
+                case '\0':
+                    return { line, TokenType::FILE_END, {} };
+                case '\n':
+                    index++;
+                    return { line++, TokenType::NEW_LINE, {} };
+                case '{':
+                    index++;
+                    return { line, TokenType::BRACKET_OPEN, {} };
+                case '}':
+                    index++;
+                    return { line, TokenType::BRACKET_CLOSE, {} };
+                case '#':
+                    // Comments go on until the end of the line, the newline is still a token
+                    while(peek() != '\n' && peek() != '\0') index++;
+                    continue;
+                case '"':
+                    return read_string();
+                default:
+                    return read_word();
+            }
+        }
+    }
+
+    char Lexer::peek() {
+        if(index >= text.size())
+            return '\0';
+        return text[index];
+    }
+
+    Token Lexer::read_word() {
+        size_t start = index;
+        while(1) {
+            char c = peek();
+            if(c == '\0' || c == '\n' || c == ' ' || c == '\t' || c == '\r' || c == '{' ||
+               c == '}' || c == '#')
+                break;
+            index++;
+        }
+
+        return { line, TokenType::ARG, text.substr(start, index - start) };
+    }
+
+    Token Lexer::read_string() {
+        // Skip the opening quote
+        size_t start = ++index;
+        while(peek() != '"') {
+            if(peek() == '\0' || peek() == '\n') {
+                wlr_log(WLR_ERROR, "Error on line %d: opened string is never closed", line);
+                return { line, TokenType::UNKNOWN, {} };
+            }
+            index++;
+        }
+
+        // Skip the closing quote
+        index++;
+        return { line, TokenType::STRING, text.substr(start, index - start - 1) };
+    }
+
+    Parser::Parser(std::string_view text)
+        : lexer(text),
+          current(lexer.next()) {}
+
+    void Parser::parse() {
+        while(current.type != TokenType::FILE_END) {
+            if(current.type == TokenType::NEW_LINE)
+                advance();
+            else
+                read_command();
+        }
+    }
+
+    std::span<const std::string_view> Parser::words(const Statement& statement) const {
+        return std::span<const std::string_view>(all_words).subspan(statement.first,
+                                                                    statement.count);
+    }
+
+    void Parser::advance() {
+        current = lexer.next();
+    }
+
+    void Parser::recover() {
+        while(current.type != TokenType::NEW_LINE && current.type != TokenType::FILE_END)
+            advance();
+        if(current.type == TokenType::NEW_LINE)
+            advance();
+    }
+
+    void Parser::read_command() {
+        if(current.type == TokenType::BRACKET_CLOSE) {
+            wlr_log(WLR_ERROR, "Error on line %d: unexpected '}'", current.line);
+            advance();
+            return;
+        }
+        if(current.type != TokenType::ARG) {
+            wlr_log(WLR_ERROR, "Error on line %d: expected command", current.line);
+            recover();
+            return;
+        }
+
+        int line = current.line;
+        size_t first = all_words.size();
+        size_t count = read_words();
+
+        switch(current.type) {
+            case TokenType::BRACKET_OPEN:
+                advance();
+                read_block(line, first, count);
+                // The prefix isn't a statement by itself
+                return;
+            case TokenType::UNKNOWN:
+                all_words.resize(first);
+                recover();
+                return;
+            case TokenType::NEW_LINE:
+                advance();
+                break;
+            default:
+                // FILE_END or a stray '}', which is reported by the next read_command()
+                break;
+        }
+
+        statements.push_back({ line, first, count });
+    }
+
+    void Parser::read_block(int line, size_t prefix_first, size_t prefix_count) {
+        while(1) {
+            switch(current.type) {
+                case TokenType::NEW_LINE:
+                    advance();
+                    break;
+                case TokenType::BRACKET_CLOSE:
+                    advance();
+                    return;
+                case TokenType::FILE_END:
+                    wlr_log(WLR_ERROR, "Error on line %d: expected '}'", line);
+                    return;
+                case TokenType::ARG:
+                case TokenType::STRING: {
+                    int statement_line = current.line;
+                    size_t first = all_words.size();
+                    for(size_t i = 0; i < prefix_count; i++)
+                        all_words.push_back(all_words[prefix_first + i]);
+
+                    size_t count = read_words();
+                    if(current.type == TokenType::BRACKET_OPEN ||
+                       current.type == TokenType::UNKNOWN) {
+                        if(current.type == TokenType::BRACKET_OPEN)
+                            wlr_log(WLR_ERROR, "Error on line %d: nested blocks aren't supported",
+                                    current.line);
+                        all_words.resize(first);
+                        recover();
+                        break;
+                    }
+
+                    statements.push_back({ statement_line, first, prefix_count + count });
+                    if(current.type == TokenType::NEW_LINE)
+                        advance();
+                    break;
+                }
+                default:
+                    wlr_log(WLR_ERROR, "Error on line %d: unexpected token in block",
+                            current.line);
+                    recover();
+                    break;
+            }
+        }
+    }
+
+    size_t Parser::read_words() {
+        size_t count = 0;
+        while(current.type == TokenType::ARG || current.type == TokenType::STRING) {
+            all_words.push_back(current.val);
+            count++;
+            advance();
+        }
+
+        return count;
+    }
+}
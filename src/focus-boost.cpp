@@ -0,0 +1,135 @@
+#include "focus-boost.hpp"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "config/config.hpp"
+
+namespace focus_boost {
+    // Even with the capability, clients never get a nice value below this one
+    constexpr int MIN_NICE = -10;
+
+    pid_t boosted_pid = 0;
+    // The boost is dropped when it disconnects, before its pid can be reused
+    wl_client* boosted_client = nullptr;
+    wl_listener client_destroy;
+    // Nice value of every boosted thread before the boost
+    std::unordered_map<pid_t, int> original;
+    // Every thread of the process when it was boosted, including the skipped ones
+    std::unordered_set<pid_t> existing;
+    // Set once the compositor turned out not to be allowed to lower nice values
+    bool disabled = false;
+
+    std::vector<pid_t> threads(pid_t pid) {
+        std::vector<pid_t> tids;
+
+        std::error_code ec;
+        std::filesystem::directory_iterator it("/proc/" + std::to_string(pid) + "/task", ec);
+        for(; !ec && it != std::filesystem::directory_iterator(); it.increment(ec))
+            tids.push_back(atoi(it->path().filename().c_str()));
+
+        return tids;
+    }
+
+    void restore() {
+        if(!boosted_pid)
+            return;
+
+        // Can only fail if the thread exited in the meantime
+        for(auto [tid, nice] : original) setpriority(PRIO_PROCESS, tid, nice);
+
+        // Threads started during the boost inherited it from the main thread, threads that
+        // were skipped or failed keep their own value
+        auto main_thread = original.find(boosted_pid);
+        if(main_thread != original.end()) {
+            for(pid_t tid : threads(boosted_pid)) {
+                if(!existing.contains(tid))
+                    setpriority(PRIO_PROCESS, tid, main_thread->second);
+            }
+        }
+
+        wlr_log(WLR_DEBUG, "restored the nice values of pid %d", boosted_pid);
+        original.clear();
+        existing.clear();
+        boosted_pid = 0;
+        if(boosted_client) {
+            wl_list_remove(&client_destroy.link);
+            boosted_client = nullptr;
+        }
+    }
+
+    void handle_client_destroy(wl_listener* listener, void* data) {
+        restore();
+    }
+
+    void boost(wl_client* client, pid_t pid, int levels) {
+        boosted_pid = pid;
+        boosted_client = client;
+        // Clients have no public destroy signal, so this can't be a wrapper::Listener
+        client_destroy.notify = handle_client_destroy;
+        wl_client_add_destroy_listener(client, &client_destroy);
+
+        for(pid_t tid : threads(pid)) {
+            existing.insert(tid);
+            errno = 0;
+            int nice = getpriority(PRIO_PROCESS, tid);
+            if(errno)
+                continue;
+
+            int target = std::max(nice - levels, MIN_NICE);
+            if(target >= nice)
+                continue;
+
+            if(setpriority(PRIO_PROCESS, tid, target) < 0) {
+                // Lowering nice values needs CAP_SYS_NICE or a high enough RLIMIT_NICE
+                if(errno == EACCES) {
+                    wlr_log(WLR_ERROR,
+                            "not allowed to lower nice values (needs CAP_SYS_NICE or "
+                            "RLIMIT_NICE), disabling focus_boost");
+                    disabled = true;
+                    restore();
+                    return;
+                }
+
+                wlr_log(WLR_DEBUG, "failed to boost thread %d of pid %d: %s", tid, pid,
+                        strerror(errno));
+                continue;
+            }
+
+            original[tid] = nice;
+        }
+
+        wlr_log(WLR_DEBUG, "boosted %zu threads of pid %d by %d", original.size(), pid, levels);
+    }
+
+    void focus(wlr_surface* surface) {
+        wl_client* client = nullptr;
+        pid_t pid = 0;
+        uid_t uid = 0;
+        if(surface && conf.focus_boost && !disabled) {
+            client = wl_resource_get_client(surface->resource);
+            wl_client_get_credentials(client, &pid, &uid, nullptr);
+        }
+
+        // The compositor's own connections are left alone, and so are processes of other
+        // users, which CAP_SYS_NICE would otherwise allow changing
+        if(pid == getpid() || uid != getuid())
+            pid = 0;
+
+        if(pid == boosted_pid && (!pid || client == boosted_client))
+            return;
+
+        restore();
+        if(pid > 0)
+            boost(client, pid, conf.focus_boost);
+    }
+}
@@ -0,0 +1,338 @@
+#include "frame-pacing.hpp"
+
+#include <algorithm>
+#include <unordered_map>
+
+#include "commit-timing-v1-protocol.h"
+#include "fifo-v1-protocol.h"
+#include "server.hpp"
+#include "util.hpp"
+
+namespace frame_pacing {
+    // Nothing presents surfaces that aren't on any output, their barriers get cleared at
+    // this rate instead
+    constexpr uint64_t HIDDEN_INTERVAL_NS = 1000 * 1000 * 1000;
+
+    std::unordered_map<wlr_surface*, Surface*> surfaces;
+
+    Surface* get_surface(wl_resource* surface_resource) {
+        wlr_surface* surface = wlr_surface_from_resource(surface_resource);
+        auto it = surfaces.find(surface);
+        if(it != surfaces.end())
+            return it->second;
+        return surfaces[surface] = new Surface(surface);
+    }
+
+    void destroy_resource(wl_client* client, wl_resource* resource) {
+        wl_resource_destroy(resource);
+    }
+
+    // Surface of a fifo or commit timer, null once it was destroyed
+    Surface* from_resource(wl_resource* resource) {
+        return static_cast<Surface*>(wl_resource_get_user_data(resource));
+    }
+
+    void fifo_set_barrier(wl_client* client, wl_resource* resource) {
+        Surface* surface = from_resource(resource);
+        if(!surface) {
+            wl_resource_post_error(resource, WP_FIFO_V1_ERROR_SURFACE_DESTROYED,
+                                   "the surface was destroyed");
+            return;
+        }
+        surface->set_barrier = true;
+    }
+
+    void fifo_wait_barrier(wl_client* client, wl_resource* resource) {
+        Surface* surface = from_resource(resource);
+        if(!surface) {
+            wl_resource_post_error(resource, WP_FIFO_V1_ERROR_SURFACE_DESTROYED,
+                                   "the surface was destroyed");
+            return;
+        }
+        surface->wait_barrier = true;
+    }
+
+    const struct wp_fifo_v1_interface fifo_impl = {
+        .set_barrier = fifo_set_barrier,
+        .wait_barrier = fifo_wait_barrier,
+        .destroy = destroy_resource,
+    };
+
+    // Commits already held keep waiting, the next ones don't
+    void fifo_destroy(wl_resource* resource) {
+        Surface* surface = from_resource(resource);
+        if(!surface)
+            return;
+
+        surface->fifo = nullptr;
+        surface->set_barrier = false;
+        surface->wait_barrier = false;
+    }
+
+    void get_fifo(wl_client* client, wl_resource* manager, uint32_t id,
+                  wl_resource* surface_resource) {
+        Surface* surface = get_surface(surface_resource);
+        if(surface->fifo) {
+            wl_resource_post_error(manager, WP_FIFO_MANAGER_V1_ERROR_ALREADY_EXISTS,
+                                   "the surface already has a fifo");
+            return;
+        }
+
+        wl_resource* resource =
+            wl_resource_create(client, &wp_fifo_v1_interface, wl_resource_get_version(manager), id);
+        if(!resource) {
+            wl_client_post_no_memory(client);
+            return;
+        }
+        wl_resource_set_implementation(resource, &fifo_impl, surface, fifo_destroy);
+        surface->fifo = resource;
+    }
+
+    const struct wp_fifo_manager_v1_interface fifo_manager_impl = {
+        .destroy = destroy_resource,
+        .get_fifo = get_fifo,
+    };
+
+    void bind_fifo_manager(wl_client* client, void* data, uint32_t version, uint32_t id) {
+        wl_resource* resource =
+            wl_resource_create(client, &wp_fifo_manager_v1_interface, version, id);
+        if(!resource) {
+            wl_client_post_no_memory(client);
+            return;
+        }
+        wl_resource_set_implementation(resource, &fifo_manager_impl, nullptr, nullptr);
+    }
+
+    void timer_set_timestamp(wl_client* client, wl_resource* resource, uint32_t tv_sec_hi,
+                             uint32_t tv_sec_lo, uint32_t tv_nsec) {
+        Surface* surface = from_resource(resource);
+        if(!surface) {
+            wl_resource_post_error(resource, WP_COMMIT_TIMER_V1_ERROR_SURFACE_DESTROYED,
+                                   "the surface was destroyed");
+            return;
+        }
+        if(tv_nsec >= 1000 * 1000 * 1000) {
+            wl_resource_post_error(resource, WP_COMMIT_TIMER_V1_ERROR_INVALID_TIMESTAMP,
+                                   "tv_nsec is out of range");
+            return;
+        }
+        if(surface->timestamp) {
+            wl_resource_post_error(resource, WP_COMMIT_TIMER_V1_ERROR_TIMESTAMP_EXISTS,
+                                   "the commit already has a timestamp");
+            return;
+        }
+
+        uint64_t sec = (uint64_t)tv_sec_hi << 32 | tv_sec_lo;
+        // Timestamps at the epoch are already in the past, so 0 can mean unset
+        surface->timestamp = std::max<uint64_t>(sec * 1000 * 1000 * 1000 + tv_nsec, 1);
+    }
+
+    const struct wp_commit_timer_v1_interface timer_impl = {
+        .set_timestamp = timer_set_timestamp,
+        .destroy = destroy_resource,
+    };
+
+    void timer_destroy(wl_resource* resource) {
+        Surface* surface = from_resource(resource);
+        if(!surface)
+            return;
+
+        surface->timer = nullptr;
+        surface->timestamp = 0;
+    }
+
+    void get_timer(wl_client* client, wl_resource* manager, uint32_t id,
+                   wl_resource* surface_resource) {
+        Surface* surface = get_surface(surface_resource);
+        if(surface->timer) {
+            wl_resource_post_error(manager, WP_COMMIT_TIMING_MANAGER_V1_ERROR_COMMIT_TIMER_EXISTS,
+                                   "the surface already has a commit timer");
+            return;
+        }
+
+        wl_resource* resource = wl_resource_create(client, &wp_commit_timer_v1_interface,
+                                                   wl_resource_get_version(manager), id);
+        if(!resource) {
+            wl_client_post_no_memory(client);
+            return;
+        }
+        wl_resource_set_implementation(resource, &timer_impl, surface, timer_destroy);
+        surface->timer = resource;
+    }
+
+    const struct wp_commit_timing_manager_v1_interface timing_manager_impl = {
+        .destroy = destroy_resource,
+        .get_timer = get_timer,
+    };
+
+    void bind_timing_manager(wl_client* client, void* data, uint32_t version, uint32_t id) {
+        wl_resource* resource =
+            wl_resource_create(client, &wp_commit_timing_manager_v1_interface, version, id);
+        if(!resource) {
+            wl_client_post_no_memory(client);
+            return;
+        }
+        wl_resource_set_implementation(resource, &timing_manager_impl, nullptr, nullptr);
+    }
+
+    // Called before the commit is applied, so it can still be held
+    void client_commit(wl_listener* listener, void* data) {
+        Surface* surface = static_cast<wrapper::Listener<Surface>*>(listener)->container;
+        Surface::Commit commit = { 0, surface->set_barrier, surface->wait_barrier,
+                                   surface->timestamp };
+        surface->set_barrier = false;
+        surface->wait_barrier = false;
+        surface->timestamp = 0;
+
+        uint64_t now = now_ns();
+        if(surface->held.empty() && surface->ready(commit, now, 0)) {
+            if(commit.set_barrier) {
+                surface->barrier = true;
+                surface->barrier_shown = false;
+            }
+            return;
+        }
+
+        commit.lock = wlr_surface_lock_pending(surface->surface);
+        surface->held.push_back(commit);
+        surface->wait(now);
+    }
+
+    void surface_destroy(wl_listener* listener, void* data) {
+        Surface* surface = static_cast<wrapper::Listener<Surface>*>(listener)->container;
+        surfaces.erase(surface->surface);
+        delete surface;
+    }
+
+    // Wakes a surface up for its first held commit when frames can't
+    int timeout(void* data) {
+        Surface* surface = static_cast<Surface*>(data);
+        uint64_t now = now_ns();
+        if(!wl_list_empty(&surface->surface->current_outputs)) {
+            surface->schedule_frames();
+            return 0;
+        }
+
+        if(!surface->held.empty() && surface->held.front().wait_barrier)
+            surface->barrier = false;
+        surface->release(now, 0);
+        surface->wait(now);
+        return 0;
+    }
+
+    void init(wl_display* display) {
+        wl_global_create(display, &wp_fifo_manager_v1_interface, 1, nullptr, bind_fifo_manager);
+        wl_global_create(display, &wp_commit_timing_manager_v1_interface, 1, nullptr,
+                         bind_timing_manager);
+    }
+
+    void frame(wlr_output* output) {
+        uint64_t now = now_ns();
+        // The commit of this frame gets presented about a refresh from now
+        uint64_t refresh_ns = output->refresh > 0 ? 1000ull * 1000 * 1000 * 1000 / output->refresh
+                                                  : 0;
+
+        for(auto& [_, surface] : surfaces) {
+            bool on_output = false;
+            wlr_surface_output* surface_output;
+            wl_list_for_each(surface_output, &surface->surface->current_outputs, link) {
+                on_output |= surface_output->output == output;
+            }
+            if(!on_output)
+                continue;
+
+            // A frame event means the last commit was presented
+            if(surface->barrier_shown)
+                surface->barrier = false;
+            surface->release(now, refresh_ns);
+            surface->barrier_shown = surface->barrier;
+            surface->wait(now);
+        }
+    }
+
+    Surface::Surface(wlr_surface* surface)
+        : surface(surface),
+          fifo(nullptr),
+          timer(nullptr),
+          set_barrier(false),
+          wait_barrier(false),
+          timestamp(0),
+          barrier(false),
+          barrier_shown(false),
+          wakeup(wl_event_loop_add_timer(wl_display_get_event_loop(server.display),
+                                         frame_pacing::timeout, this)),
+
+          client_commit(this, frame_pacing::client_commit, &surface->events.client_commit),
+          destroy(this, surface_destroy, &surface->events.destroy) {}
+
+    // The held states go away with the surface
+    Surface::~Surface() {
+        wl_event_source_remove(wakeup);
+        if(fifo)
+            wl_resource_set_user_data(fifo, nullptr);
+        if(timer)
+            wl_resource_set_user_data(timer, nullptr);
+    }
+
+    bool Surface::ready(const Commit& commit, uint64_t now, uint64_t lookahead_ns) {
+        return (!commit.wait_barrier || !barrier) && commit.timestamp <= now + lookahead_ns;
+    }
+
+    void Surface::release(uint64_t now, uint64_t lookahead_ns) {
+        while(!held.empty() && ready(held.front(), now, lookahead_ns)) {
+            Commit commit = held.front();
+            held.pop_front();
+            if(commit.set_barrier) {
+                barrier = true;
+                barrier_shown = false;
+            }
+            // Applies the commit, unless something else also locked it
+            wlr_surface_unlock_cached(surface, commit.lock);
+        }
+    }
+
+    uint64_t Surface::refresh_ns() {
+        uint64_t refresh = 0;
+        wlr_surface_output* surface_output;
+        wl_list_for_each(surface_output, &surface->current_outputs, link) {
+            if(surface_output->output->refresh <= 0)
+                continue;
+            uint64_t period = 1000ull * 1000 * 1000 * 1000 / surface_output->output->refresh;
+            refresh = refresh ? std::min(refresh, period) : period;
+        }
+        return refresh;
+    }
+
+    void Surface::schedule_frames() {
+        wlr_surface_output* surface_output;
+        wl_list_for_each(surface_output, &surface->current_outputs, link) {
+            wlr_output_schedule_frame(surface_output->output);
+        }
+    }
+
+    void Surface::wait(uint64_t now) {
+        if(held.empty())
+            return;
+
+        const Commit& next = held.front();
+        bool hidden = wl_list_empty(&surface->current_outputs);
+        // Frames release commits up to a refresh ahead of their timestamp
+        uint64_t at = next.timestamp - std::min(next.timestamp, refresh_ns());
+        if(next.wait_barrier && barrier) {
+            // The barrier is cleared by the next frames of the surface's outputs
+            if(!hidden) {
+                schedule_frames();
+                return;
+            }
+            at = std::max(at, now + HIDDEN_INTERVAL_NS);
+        }
+        else if(!hidden && at <= now) {
+            schedule_frames();
+            return;
+        }
+
+        // A delay of 0 would disarm the timer
+        uint64_t delay_ms = at > now ? (at - now) / 1000 / 1000 : 0;
+        wl_event_source_timer_update(wakeup, std::max<uint64_t>(delay_ms, 1));
+    }
+}
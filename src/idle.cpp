@@ -0,0 +1,105 @@
+#include "idle.hpp"
+
+#include <algorithm>
+
+#include "server.hpp"
+#include "util.hpp"
+
+namespace idle {
+    // Idle timeouts fire at most this late, timeouts of idle daemons are in seconds anyway
+    constexpr int FLUSH_INTERVAL_MS = 500;
+
+    void new_inhibitor(wl_listener* listener, void* data) {
+        wlr_idle_inhibitor_v1* inhibitor = static_cast<wlr_idle_inhibitor_v1*>(data);
+        server.idle.inhibitors.push_back(new Inhibitor(inhibitor));
+        server.idle.update_inhibited();
+    }
+
+    void inhibitor_destroy(wl_listener* listener, void* data) {
+        Inhibitor* inhibitor = static_cast<wrapper::Listener<Inhibitor>*>(listener)->container;
+        server.idle.inhibitors.remove(inhibitor);
+        delete inhibitor;
+        server.idle.update_inhibited();
+    }
+
+    void inhibit_manager_destroy(wl_listener* listener, void* data) {
+        IdleManager* idle = static_cast<wrapper::Listener<IdleManager>*>(listener)->container;
+        idle->new_inhibitor.free();
+        idle->inhibit_manager_destroy.free();
+    }
+
+    // Called by the flush timer, passes on the activity that came since the last notify
+    int flush_activity(void* data) {
+        IdleManager* idle = static_cast<IdleManager*>(data);
+        if(idle->last_activity_ns == idle->notified_ns) {
+            idle->flush_armed = false;
+            return 0;
+        }
+
+        idle->notify();
+        wl_event_source_timer_update(idle->flush_timer, FLUSH_INTERVAL_MS);
+        return 0;
+    }
+
+    Inhibitor::Inhibitor(wlr_idle_inhibitor_v1* inhibitor)
+        : inhibitor(inhibitor),
+          destroy(this, inhibitor_destroy, &inhibitor->events.destroy) {}
+
+    IdleManager::IdleManager(wl_display* display)
+        : notifier(wlr_idle_notifier_v1_create(display)),
+          inhibit_manager(wlr_idle_inhibit_v1_create(display)),
+          inhibited(false),
+          flush_timer(wl_event_loop_add_timer(wl_display_get_event_loop(display), flush_activity,
+                                              this)),
+          flush_armed(false),
+          last_activity_ns(0),
+          notified_ns(0),
+
+          new_inhibitor(this, idle::new_inhibitor, &inhibit_manager->events.new_inhibitor),
+          inhibit_manager_destroy(this, idle::inhibit_manager_destroy,
+                                  &inhibit_manager->events.destroy) {}
+
+    void IdleManager::activity() {
+        last_activity_ns = now_ns();
+        if(flush_armed)
+            return;
+
+        // The first event after a quiet period goes through right away, so idle clients
+        // are told about the resume without delay
+        notify();
+        flush_armed = true;
+        wl_event_source_timer_update(flush_timer, FLUSH_INTERVAL_MS);
+    }
+
+    void IdleManager::notify() {
+        notified_ns = last_activity_ns;
+        wlr_idle_notifier_v1_notify_activity(notifier, server.input_manager.seat.seat);
+    }
+
+    void IdleManager::update_inhibited() {
+        bool inhibit = std::any_of(inhibitors.begin(), inhibitors.end(), [](Inhibitor* i) {
+            wlr_surface* surface = wlr_surface_get_root_surface(i->inhibitor->surface);
+            if(!surface->mapped)
+                return false;
+
+            for(xdg_shell::Toplevel* toplevel : server.toplevels) {
+                if(toplevel->surface() != surface)
+                    continue;
+
+                // Hidden behind another workspace or a fullscreen toplevel
+                workspace::Workspace* ws = toplevel->workspace;
+                return ws && ws->active && (!ws->fullscreen || ws->focused_toplevel == toplevel);
+            }
+
+            // Layer surfaces and the like are visible as long as they're mapped
+            return true;
+        });
+
+        if(inhibit == inhibited)
+            return;
+
+        inhibited = inhibit;
+        wlr_idle_notifier_v1_set_inhibited(notifier, inhibited);
+        wlr_log(WLR_DEBUG, "idle %s", inhibited ? "inhibited" : "uninhibited");
+    }
+}
@@ -6,10 +6,17 @@
 #include <cassert>
 #include <cstdlib>
 #include <format>
+#include <list>
+#include <memory>
 
+#include "focus-boost.hpp"
 #include "layer-shell.hpp"
 #include "server.hpp"
+#include "trace.hpp"
 #include "util.hpp"
+#ifdef HAVE_XWAYLAND
+#include "xwayland.hpp"
+#endif
 
 #define DEFAULT_SEAT "seat0"
 
@@ -19,6 +26,7 @@ namespace cursor {
         Cursor *cursor = static_cast<wrapper::Listener<Cursor> *>(listener)->container;
         wlr_pointer_motion_event *event = static_cast<wlr_pointer_motion_event *>(data);
 
+        server.idle.activity();
         wlr_cursor_move(cursor->cursor, &event->pointer->base, event->delta_x, event->delta_y);
         cursor->process_motion(event->time_msec);
     }
@@ -29,6 +37,7 @@ namespace cursor {
         wlr_pointer_motion_absolute_event *event =
             static_cast<wlr_pointer_motion_absolute_event *>(data);
 
+        server.idle.activity();
         wlr_cursor_warp_absolute(cursor->cursor, &event->pointer->base, event->x, event->y);
         cursor->process_motion(event->time_msec);
     }
@@ -37,6 +46,7 @@ namespace cursor {
     void button(wl_listener *listener, void *data) {
         Cursor *cursor = static_cast<wrapper::Listener<Cursor> *>(listener)->container;
         wlr_pointer_button_event *event = static_cast<wlr_pointer_button_event *>(data);
+        server.idle.activity();
         wlr_seat_pointer_notify_button(server.input_manager.seat.seat, event->time_msec,
                                        event->button, event->state);
 
@@ -67,6 +77,7 @@ namespace cursor {
     void axis(wl_listener *listener, void *data) {
         wlr_pointer_axis_event *event = static_cast<wlr_pointer_axis_event *>(data);
 
+        server.idle.activity();
         wlr_seat_pointer_notify_axis(server.input_manager.seat.seat, event->time_msec,
                                      event->orientation, event->delta, event->delta_discrete,
                                      event->source, event->relative_direction);
@@ -121,6 +132,8 @@ namespace cursor {
     }
 
     void Cursor::process_motion(uint32_t time) {
+        TRACE_SCOPE("cursor::process_motion");
+
         // Handle workspace focus
         workspace::Workspace *ws = server.output_manager.focused_output()->active_workspace;
         assert(ws);
@@ -163,6 +176,16 @@ namespace cursor {
             return;
         }
 
+#ifdef HAVE_XWAYLAND
+        // Override redirect Xwayland windows only get the pointer
+        surface = xwayland::unmanaged_at(cursor->x, cursor->y, sx, sy);
+        if(surface) {
+            wlr_seat_pointer_notify_enter(server.input_manager.seat.seat, surface, sx, sy);
+            wlr_seat_pointer_notify_motion(server.input_manager.seat.seat, time, sx, sy);
+            return;
+        }
+#endif
+
         // Otherwise, set the default image and clear the focus
         set_image("default");
         wlr_seat_pointer_clear_focus(server.input_manager.seat.seat);
@@ -183,16 +206,16 @@ namespace cursor {
         }
         else {
             // Black magic i don't understand
-            wlr_box *geo_box = &toplevel->toplevel->base->geometry;
-            double border_x = (toplevel->scene_tree->node.x + geo_box->x) +
-                              ((edges & WLR_EDGE_RIGHT) ? geo_box->width : 0);
-            double border_y = (toplevel->scene_tree->node.y + geo_box->y) +
-                              ((edges & WLR_EDGE_BOTTOM) ? geo_box->height : 0);
+            wlr_box geo_box = toplevel->geometry();
+            double border_x = (toplevel->scene_tree->node.x + geo_box.x) +
+                              ((edges & WLR_EDGE_RIGHT) ? geo_box.width : 0);
+            double border_y = (toplevel->scene_tree->node.y + geo_box.y) +
+                              ((edges & WLR_EDGE_BOTTOM) ? geo_box.height : 0);
 
             grab_x = cursor->x - border_x;
             grab_y = cursor->y - border_y;
 
-            grab_geobox = *geo_box;
+            grab_geobox = geo_box;
             grab_geobox.x += toplevel->scene_tree->node.x;
             grab_geobox.y += toplevel->scene_tree->node.y;
 
@@ -211,7 +234,7 @@ namespace cursor {
         int x = cursor->x - grab_x;
         int y = cursor->y - grab_y;
 
-        wlr_scene_node_set_position(&grabbed_toplevel->scene_tree->node, x, y);
+        grabbed_toplevel->set_position(x, y);
 
         output::Output *output = server.output_manager.output_at(x, y);
         if(output && output->active_workspace != grabbed_toplevel->workspace) {
@@ -260,21 +283,57 @@ namespace cursor {
             }
         }
 
-        wlr_box *geo_box = &toplevel->toplevel->base->geometry;
-        wlr_scene_node_set_position(&toplevel->scene_tree->node, new_left - geo_box->x,
-                                    new_top - geo_box->y);
+        wlr_box geo_box = toplevel->geometry();
+        toplevel->set_position(new_left - geo_box.x, new_top - geo_box.y);
 
         int new_width = new_right - new_left;
         int new_height = new_bottom - new_top;
-        wlr_xdg_toplevel_set_size(toplevel->toplevel, new_width, new_height);
+        toplevel->set_size(new_width, new_height);
     }
 }
 
 namespace keyboard {
+    // Keymap shared by every keyboard, compiled once by a worker
+    xkb_keymap *shared_keymap = nullptr;
+    bool keymap_compiling = false;
+    // Keyboards configured before the keymap was ready
+    std::list<Keyboard *> waiting_for_keymap;
+
+    void compile_keymap() {
+        keymap_compiling = true;
+        auto keymap = std::make_shared<xkb_keymap *>(nullptr);
+
+        server.workers.submit(
+            [keymap] {
+                TRACE_SCOPE("keyboard::compile_keymap");
+                // Contexts aren't thread-safe, so the worker uses its own
+                xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+                if(!context)
+                    return;
+
+                *keymap = xkb_keymap_new_from_names(context, nullptr, XKB_KEYMAP_COMPILE_NO_FLAGS);
+                xkb_context_unref(context);
+            },
+            [keymap] {
+                keymap_compiling = false;
+                if(!*keymap) {
+                    wlr_log(WLR_ERROR, "failed compiling the keymap");
+                    waiting_for_keymap.clear();
+                    return;
+                }
+
+                shared_keymap = *keymap;
+                std::list<Keyboard *> waiting;
+                waiting.swap(waiting_for_keymap);
+                for(Keyboard *keyboard : waiting) keyboard->set_keymap(shared_keymap);
+            });
+    }
+
     bool handle_keybind(const config::Bind &bind) {
         for(auto &[cur_bind, command] : conf.binds) {
             if(cur_bind == bind) {
-                command->execute(ConfigLoadPhase::BIND);
+                TRACE_SCOPE("keyboard::bind");
+                command->execute(conf, ConfigLoadPhase::BIND);
                 return true;
             }
         }
@@ -293,8 +352,14 @@ namespace keyboard {
 
     // Called when a key is pressed or released
     void key(wl_listener *listener, void *data) {
+        TRACE_SCOPE("keyboard::key");
         Keyboard *keyboard = static_cast<wrapper::Listener<Keyboard> *>(listener)->container;
         wlr_keyboard_key_event *event = static_cast<wlr_keyboard_key_event *>(data);
+        server.idle.activity();
+
+        // Keys pressed before the keymap is compiled can't be translated
+        if(!keyboard->keyboard->keymap)
+            return;
 
         // libinput keycode -> xkbcommon
         uint32_t keycode = event->keycode + 8;
@@ -355,6 +420,8 @@ namespace keyboard {
         keyboard->data = this;
     }
 
+    Keyboard::~Keyboard() { waiting_for_keymap.remove(this); }
+
     void Keyboard::configure() {
         int rate = 25;
         int delay = 500;
@@ -367,14 +434,21 @@ namespace keyboard {
             wlr_keyboard_set_repeat_info(keyboard, rate, delay);
         }
 
-        xkb_context *context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
-        xkb_keymap *keymap =
-            xkb_keymap_new_from_names(context, nullptr, XKB_KEYMAP_COMPILE_NO_FLAGS);
+        if(shared_keymap) {
+            set_keymap(shared_keymap);
+            return;
+        }
+
+        if(std::find(waiting_for_keymap.begin(), waiting_for_keymap.end(), this) ==
+           waiting_for_keymap.end())
+            waiting_for_keymap.push_back(this);
+        if(!keymap_compiling)
+            compile_keymap();
+    }
 
+    void Keyboard::set_keymap(xkb_keymap *keymap) {
         // Assign XKB keymap
         wlr_keyboard_set_keymap(keyboard, keymap);
-        xkb_keymap_unref(keymap);
-        xkb_context_unref(context);
 
         wlr_seat *seat = server.input_manager.seat.seat;
         wlr_keyboard *current_keyboard = wlr_seat_get_keyboard(seat);
@@ -496,9 +570,12 @@ namespace seat {
         : node(node),
           seat(seat),
 
-          destroy(this, seat::seat_node_destroy, &node->events.node_destroy) {}
+          destroy(this, seat::seat_node_destroy, &node->events.node_destroy) {
+        metrics::seat_nodes.inc();
+    }
 
     SeatNode::~SeatNode() {
+        metrics::seat_nodes.dec();
         std::list<SeatNode *> &stack =
             node->has_exclusivity() ? seat->exclusivity_stack : seat->focus_stack;
 
@@ -597,7 +674,7 @@ namespace seat {
 
         previous_toplevel = seat_node;
 
-        focus_surface(node->val.toplevel->toplevel->base->surface, true);
+        focus_surface(node->val.toplevel->surface(), true);
         focused_node = seat_node;
 
         workspace::Workspace *ws = node->val.toplevel->workspace;
@@ -608,14 +685,19 @@ namespace seat {
     }
 
     void Seat::focus_surface(wlr_surface *surface, bool toplevel) {
+        server.ipc.notify(ipc::SUBSCRIBE_FOCUS);
+        metrics::focus_changes.inc();
+        // Layer surfaces don't take the boost away from the toplevel
+        if(!surface || toplevel)
+            focus_boost::focus(surface);
+
         if(focused_node && focused_node->node->type == nodes::NodeType::TOPLEVEL) {
             if(!surface || toplevel)
                 update_toplevel_activation(focused_node->node, false);
         }
 
         if(!surface) {
-            if(previous_toplevel &&
-               previous_toplevel->node->val.toplevel->toplevel->base->surface->mapped) {
+            if(previous_toplevel && previous_toplevel->node->val.toplevel->surface()->mapped) {
                 wlr_seat_keyboard_notify_clear_focus(seat);
                 focus_node(previous_toplevel->node);
                 previous_toplevel = nullptr;
@@ -735,7 +817,7 @@ namespace seat {
 
     void Seat::update_toplevel_activation(nodes::Node *node, bool activate) {
         if(node && node->type == nodes::NodeType::TOPLEVEL) {
-            wlr_xdg_toplevel_set_activated(node->val.toplevel->toplevel, activate);
+            node->val.toplevel->set_activated(activate);
             if(activate)
                 wlr_scene_node_raise_to_top(&node->val.toplevel->scene_tree->node);
         }
@@ -0,0 +1,639 @@
+#include "ipc.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "config/commands.hpp"
+#include "config/config.hpp"
+#include "config/parser.hpp"
+#include "metrics.hpp"
+#include "server.hpp"
+#include "trace.hpp"
+#include "watchdog.hpp"
+
+namespace ipc {
+    // Messages bigger than this are treated as garbage
+    constexpr size_t MAX_PAYLOAD = 1 << 20;
+    // Past this many unsent bytes, requests and events of a client are held back
+    constexpr size_t HIGH_WATERMARK = 256 * 1024;
+    // Reads per dispatch, so a single client can't starve the event loop
+    constexpr int MAX_READS = 16;
+
+    std::string_view or_empty(const char* str) {
+        return str ? std::string_view(str) : std::string_view();
+    }
+
+    // Called by the event loop when there are pending connections
+    int handle_connection(int fd, uint32_t mask, void* data) {
+        IpcServer* ipc = static_cast<IpcServer*>(data);
+
+        while(1) {
+            int client_fd = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if(client_fd < 0) {
+                if(errno == EINTR)
+                    continue;
+                if(errno != EAGAIN && errno != EWOULDBLOCK)
+                    wlr_log_errno(WLR_ERROR, "failed accepting IPC client");
+                break;
+            }
+
+            Client* client = new Client(client_fd);
+            client->source = wl_event_loop_add_fd(ipc->loop, client_fd, WL_EVENT_READABLE,
+                                                  handle_client, client);
+            if(!client->source) {
+                wlr_log(WLR_ERROR, "failed adding IPC client to the event loop");
+                close(client_fd);
+                delete client;
+                continue;
+            }
+
+            ipc->clients.push_back(client);
+        }
+
+        return 0;
+    }
+
+    // Called by the event loop when a client is readable, writable or gone
+    int handle_client(int fd, uint32_t mask, void* data) {
+        Client* client = static_cast<Client*>(data);
+        IpcServer& ipc = server.ipc;
+
+        bool ok = !(mask & (WL_EVENT_ERROR | WL_EVENT_HANGUP));
+        if(ok && (mask & WL_EVENT_READABLE))
+            ok = ipc.read_input(client);
+        // Also resumes requests held back while the client wasn't reading
+        if(ok)
+            ok = ipc.process_input(client) && ipc.write_out(client);
+        if(ok && client->eof && !client->backlog())
+            ok = false;
+
+        if(ok)
+            ipc.update_mask(client);
+        else
+            ipc.disconnect(client);
+
+        return 0;
+    }
+
+    // Idle callback, sends every event marked since the last flush
+    void flush_events(void* data) {
+        IpcServer* ipc = static_cast<IpcServer*>(data);
+        ipc->flush_scheduled = false;
+
+        uint32_t events = ipc->dirty_events;
+        ipc->dirty_events = 0;
+
+        uint32_t subscribed = 0;
+        for(Client* client : ipc->clients) subscribed |= client->subscriptions;
+        events &= subscribed;
+        if(!events)
+            return;
+
+        // Each event is built once, no matter how many clients get it
+        std::vector<std::pair<uint32_t, Message>> messages;
+        for(uint32_t event : { SUBSCRIBE_WORKSPACE, SUBSCRIBE_FOCUS, SUBSCRIBE_OUTPUT }) {
+            if(events & event)
+                messages.emplace_back(event, ipc->event(event));
+        }
+
+        for(auto it = ipc->clients.begin(); it != ipc->clients.end();) {
+            // write_out() can disconnect the client
+            Client* client = *it++;
+
+            uint32_t wanted = events & client->subscriptions;
+            if(!wanted)
+                continue;
+
+            if(client->backlog() >= HIGH_WATERMARK) {
+                client->held_events |= wanted;
+                continue;
+            }
+
+            for(auto& [event, message] : messages) {
+                if(wanted & event)
+                    ipc->queue(client, message);
+            }
+
+            if(ipc->write_out(client))
+                ipc->update_mask(client);
+            else
+                ipc->disconnect(client);
+        }
+    }
+
+    Message::Message(MessageType type)
+        : data(HEADER_SIZE, '\0') {
+        uint16_t val = static_cast<uint16_t>(type);
+        memcpy(&data[4], &val, sizeof(val));
+    }
+
+    void Message::u8(uint8_t val) {
+        data.push_back(static_cast<char>(val));
+    }
+
+    void Message::u32(uint32_t val) {
+        data.append(reinterpret_cast<const char*>(&val), sizeof(val));
+    }
+
+    void Message::i32(int32_t val) {
+        data.append(reinterpret_cast<const char*>(&val), sizeof(val));
+    }
+
+    void Message::u64(uint64_t val) {
+        data.append(reinterpret_cast<const char*>(&val), sizeof(val));
+    }
+
+    void Message::str(std::string_view val) {
+        u32(val.size());
+        data.append(val);
+    }
+
+    void Message::finish() {
+        uint32_t length = data.size() - HEADER_SIZE;
+        memcpy(&data[0], &length, sizeof(length));
+    }
+
+    Client::Client(int fd)
+        : fd(fd),
+          source(nullptr),
+          out_sent(0),
+          subscriptions(0),
+          held_events(0),
+          eof(false) {}
+
+    size_t Client::backlog() {
+        return out.size() - out_sent;
+    }
+
+    IpcServer::IpcServer(wl_display* display)
+        : loop(wl_display_get_event_loop(display)),
+          fd(-1),
+          source(nullptr),
+          dirty_events(0),
+          flush_scheduled(false) {}
+
+    IpcServer::~IpcServer() {
+        // The event loop and its sources are already gone with the display
+        for(Client* client : clients) {
+            close(client->fd);
+            delete client;
+        }
+
+        if(fd >= 0)
+            close(fd);
+        if(!path.empty())
+            unlink(path.c_str());
+    }
+
+    bool IpcServer::start() {
+        const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+        if(!runtime_dir) {
+            wlr_log(WLR_ERROR, "XDG_RUNTIME_DIR is not set - IPC disabled");
+            return false;
+        }
+
+        std::string socket_path = std::string(runtime_dir) + "/dwc." + std::to_string(getuid()) +
+                                  "." + std::to_string(getpid()) + ".sock";
+
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if(socket_path.size() >= sizeof(addr.sun_path)) {
+            wlr_log(WLR_ERROR, "IPC socket path %s is too long - IPC disabled",
+                    socket_path.c_str());
+            return false;
+        }
+        memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if(fd < 0) {
+            wlr_log_errno(WLR_ERROR, "failed creating IPC socket");
+            return false;
+        }
+
+        // Left behind by a crashed compositor that had the same pid
+        unlink(socket_path.c_str());
+
+        if(bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+            wlr_log_errno(WLR_ERROR, "failed binding IPC socket %s", socket_path.c_str());
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        path = socket_path;
+
+        source = wl_event_loop_add_fd(loop, fd, WL_EVENT_READABLE, handle_connection, this);
+        if(!source) {
+            wlr_log(WLR_ERROR, "failed adding IPC socket to the event loop");
+            close(fd);
+            fd = -1;
+            unlink(path.c_str());
+            path.clear();
+            return false;
+        }
+
+        setenv("DWC_SOCK", path.c_str(), true);
+        wlr_log(WLR_INFO, "IPC listening on DWC_SOCK=%s", path.c_str());
+        return true;
+    }
+
+    void IpcServer::notify(uint32_t events) {
+        // Nobody to tell
+        if(clients.empty())
+            return;
+
+        dirty_events |= events;
+        if(flush_scheduled)
+            return;
+
+        // Idle sources run once the current batch of events has been dispatched,
+        // so everything that changes in the meantime is sent only once
+        flush_scheduled = wl_event_loop_add_idle(loop, flush_events, this) != nullptr;
+    }
+
+    void IpcServer::disconnect(Client* client) {
+        wl_event_source_remove(client->source);
+        close(client->fd);
+        clients.remove(client);
+        delete client;
+    }
+
+    bool IpcServer::read_input(Client* client) {
+        char buf[4096];
+        for(int i = 0; i < MAX_READS && client->backlog() < HIGH_WATERMARK; i++) {
+            ssize_t len = recv(client->fd, buf, sizeof(buf), 0);
+            if(len < 0) {
+                if(errno == EINTR)
+                    continue;
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            if(len == 0) {
+                client->eof = true;
+                return true;
+            }
+
+            client->in.append(buf, len);
+            if(!process_input(client))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool IpcServer::process_input(Client* client) {
+        size_t offset = 0;
+        while(client->in.size() - offset >= HEADER_SIZE && client->backlog() < HIGH_WATERMARK) {
+            uint32_t length;
+            uint16_t type;
+            memcpy(&length, client->in.data() + offset, sizeof(length));
+            memcpy(&type, client->in.data() + offset + 4, sizeof(type));
+
+            if(length > MAX_PAYLOAD) {
+                wlr_log(WLR_ERROR, "IPC client sent a %u byte message - disconnecting", length);
+                return false;
+            }
+            if(client->in.size() - offset - HEADER_SIZE < length)
+                break;
+
+            std::string_view payload =
+                std::string_view(client->in).substr(offset + HEADER_SIZE, length);
+            if(!handle_message(client, static_cast<MessageType>(type), payload))
+                return false;
+
+            offset += HEADER_SIZE + length;
+        }
+
+        client->in.erase(0, offset);
+        return true;
+    }
+
+    bool IpcServer::handle_message(Client* client, MessageType type, std::string_view payload) {
+        switch(type) {
+            case MessageType::COMMAND:
+                queue(client, command(payload));
+                return true;
+            case MessageType::GET_OUTPUTS:
+                queue(client, outputs(type));
+                return true;
+            case MessageType::GET_WORKSPACES:
+                queue(client, workspaces(type));
+                return true;
+            case MessageType::GET_TOPLEVELS:
+                queue(client, toplevels(type));
+                return true;
+            case MessageType::GET_FOCUS:
+                queue(client, focus(type));
+                return true;
+            case MessageType::GET_WATCHDOG:
+                queue(client, watchdog_stats());
+                return true;
+            case MessageType::GET_CLIENTS:
+                queue(client, client_stats());
+                return true;
+            case MessageType::GET_METRICS: {
+                Message reply(type);
+                reply.str(metrics::dump());
+                reply.finish();
+                queue(client, reply);
+                return true;
+            }
+            case MessageType::SUBSCRIBE: {
+                uint32_t mask = 0;
+                bool valid = payload.size() == sizeof(mask);
+                if(valid) {
+                    memcpy(&mask, payload.data(), sizeof(mask));
+                    valid = !(mask & ~SUBSCRIBE_ALL);
+                }
+
+                Message reply(type);
+                reply.u8(valid);
+                reply.finish();
+                queue(client, reply);
+
+                if(valid) {
+                    // Newly subscribed events start with the current state
+                    uint32_t added = mask & ~client->subscriptions;
+                    client->subscriptions = mask;
+                    client->held_events &= mask;
+                    queue_events(client, added);
+                }
+                return true;
+            }
+            case MessageType::TRACE: {
+                if(payload.size() != 1) {
+                    wlr_log(WLR_ERROR, "IPC client sent an invalid trace request - disconnecting");
+                    return false;
+                }
+
+                std::string path;
+                if(payload[0])
+                    trace::start();
+                else
+                    path = trace::stop();
+
+                Message reply(type);
+                reply.u8(trace::enabled.load(std::memory_order_relaxed));
+                reply.str(path);
+                reply.finish();
+                queue(client, reply);
+                return true;
+            }
+            default:
+                wlr_log(WLR_ERROR, "IPC client sent unknown message type %u - disconnecting",
+                        static_cast<unsigned>(type));
+                return false;
+        }
+    }
+
+    bool IpcServer::write_out(Client* client) {
+        // Catch up on the events missed while the client was behind
+        if(client->held_events && client->backlog() < HIGH_WATERMARK) {
+            uint32_t held = client->held_events;
+            client->held_events = 0;
+            queue_events(client, held);
+        }
+
+        while(client->backlog()) {
+            ssize_t len = ::send(client->fd, client->out.data() + client->out_sent,
+                                 client->backlog(), MSG_NOSIGNAL);
+            if(len < 0) {
+                if(errno == EINTR)
+                    continue;
+                if(errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                return false;
+            }
+            client->out_sent += len;
+        }
+
+        if(!client->backlog()) {
+            client->out.clear();
+            client->out_sent = 0;
+        }
+        else if(client->out_sent > client->out.size() / 2) {
+            client->out.erase(0, client->out_sent);
+            client->out_sent = 0;
+        }
+
+        return true;
+    }
+
+    void IpcServer::update_mask(Client* client) {
+        uint32_t mask = 0;
+        if(!client->eof && client->backlog() < HIGH_WATERMARK)
+            mask |= WL_EVENT_READABLE;
+        // Held events are queued on the next write
+        if(client->backlog() || client->held_events)
+            mask |= WL_EVENT_WRITABLE;
+
+        wl_event_source_fd_update(client->source, mask);
+    }
+
+    void IpcServer::queue(Client* client, const Message& message) {
+        client->out += message.data;
+    }
+
+    void IpcServer::queue_events(Client* client, uint32_t events) {
+        if(client->backlog() >= HIGH_WATERMARK) {
+            client->held_events |= events;
+            return;
+        }
+
+        for(uint32_t event : { SUBSCRIBE_WORKSPACE, SUBSCRIBE_FOCUS, SUBSCRIBE_OUTPUT }) {
+            if(events & event)
+                queue(client, this->event(event));
+        }
+    }
+
+    Message IpcServer::event(uint32_t event) {
+        switch(event) {
+            case SUBSCRIBE_WORKSPACE:
+                return workspaces(MessageType::EVENT_WORKSPACE);
+            case SUBSCRIBE_FOCUS:
+                return focus(MessageType::EVENT_FOCUS);
+            default:
+                return outputs(MessageType::EVENT_OUTPUT);
+        }
+    }
+
+    Message IpcServer::outputs(MessageType type) {
+        Message message(type);
+        message.u32(server.output_manager.outputs.size());
+
+        for(output::Output* output : server.output_manager.outputs) {
+            message.str(output->output->name);
+            message.u8(output->output->enabled);
+            message.i32(output->output_box.x);
+            message.i32(output->output_box.y);
+            message.i32(output->output_box.width);
+            message.i32(output->output_box.height);
+            message.u32(output->output->refresh);
+            message.u32(output->output->scale * 1000);
+            message.i32(output->active_workspace ? output->active_workspace->id : -1);
+        }
+
+        message.finish();
+        return message;
+    }
+
+    Message IpcServer::workspaces(MessageType type) {
+        std::vector<workspace::Workspace*> sorted;
+        sorted.reserve(server.root.workspaces.size());
+        for(auto& [id, ws] : server.root.workspaces) sorted.push_back(ws);
+        std::sort(sorted.begin(), sorted.end(),
+                  [](workspace::Workspace* a, workspace::Workspace* b) { return a->id < b->id; });
+
+        Message message(type);
+        message.u32(sorted.size());
+
+        for(workspace::Workspace* ws : sorted) {
+            message.i32(ws->id);
+            message.str(ws->output ? ws->output->output->name : "");
+            message.u8(ws->active);
+            message.u8(ws->fullscreen);
+            message.u32(ws->floating.size());
+        }
+
+        message.finish();
+        return message;
+    }
+
+    Message IpcServer::toplevels(MessageType type) {
+        Message message(type);
+        message.u32(server.toplevels.size());
+
+        for(xdg_shell::Toplevel* toplevel : server.toplevels) {
+            workspace::Workspace* ws = toplevel->workspace;
+            wlr_box geometry = toplevel->geometry();
+
+            message.u32(toplevel->id);
+            message.str(or_empty(toplevel->app_id()));
+            message.str(or_empty(toplevel->title()));
+            message.i32(ws ? ws->id : -1);
+            message.i32(toplevel->scene_tree->node.x);
+            message.i32(toplevel->scene_tree->node.y);
+            message.i32(geometry.width);
+            message.i32(geometry.height);
+            message.u8(ws && ws->fullscreen && ws->focused_toplevel == toplevel);
+        }
+
+        message.finish();
+        return message;
+    }
+
+    Message IpcServer::focus(MessageType type) {
+        seat::SeatNode* focused = server.input_manager.seat.focused_node;
+        xdg_shell::Toplevel* toplevel = nullptr;
+        if(focused && focused->node->type == nodes::NodeType::TOPLEVEL)
+            toplevel = focused->node->val.toplevel;
+
+        output::Output* output = server.output_manager.focused_output();
+
+        Message message(type);
+        message.u32(toplevel ? toplevel->id : 0);
+        message.str(toplevel ? or_empty(toplevel->app_id()) : "");
+        message.str(toplevel ? or_empty(toplevel->title()) : "");
+        message.i32(output && output->active_workspace ? output->active_workspace->id : -1);
+        message.str(output ? output->output->name : "");
+
+        message.finish();
+        return message;
+    }
+
+    Message IpcServer::watchdog_stats() {
+        std::vector<std::pair<watchdog::Callback*, watchdog::HandlerStats>> sorted(
+            watchdog::handler_stats.begin(), watchdog::handler_stats.end());
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const auto& a, const auto& b) { return a.second.total > b.second.total; });
+
+        Message message(MessageType::GET_WATCHDOG);
+        message.u64(watchdog::loop_stats.iterations);
+        message.u64(watchdog::loop_stats.total);
+        message.u64(watchdog::loop_stats.max);
+        message.u64(watchdog::loop_stats.stalls);
+        message.u32(sorted.size());
+
+        for(const auto& [callback, stats] : sorted) {
+            message.str(watchdog::handler_name(callback));
+            message.u64(stats.calls);
+            message.u64(stats.total);
+            message.u64(stats.max);
+            message.u64(stats.stalls);
+        }
+
+        message.finish();
+        return message;
+    }
+
+    Message IpcServer::client_stats() {
+        Message message(MessageType::GET_CLIENTS);
+        message.u32(clients::clients.size());
+
+        for(const auto& [owner, client] : clients::clients) {
+            message.i32(client->pid);
+            message.u64(client->commits);
+            message.u32(client->commit_rate);
+            message.u64(client->buffer_bytes);
+            message.u64(client->attached_bytes);
+            message.u64(client->shm_buffers);
+            message.u64(client->dmabuf_buffers);
+            message.u64(client->upload_bytes);
+            message.u64(client->frame_callbacks);
+            message.u32(client->outstanding_configures());
+            message.u8(client->throttled);
+        }
+
+        message.finish();
+        return message;
+    }
+
+    Message IpcServer::command(std::string_view text) {
+        parsing::Parser parser(text);
+        parser.parse();
+
+        std::string error;
+        std::vector<commands::Command*> parsed;
+        for(const auto& statement : parser.statements) {
+            commands::Args words = parser.words(statement);
+            commands::Command* command =
+                parse_command(words.front(), statement.line, words.subspan(1));
+            if(!command) {
+                error = "invalid command on line " + std::to_string(statement.line);
+                break;
+            }
+
+            parsed.push_back(command);
+
+            // Same rules as binds, config-only commands don't do anything at runtime
+            if(!command->subcommand_of(commands::CommandType::BIND)) {
+                error = "'" + std::string(words.front()) + "' can't be run at runtime";
+                break;
+            }
+        }
+
+        if(error.empty() && parsed.empty())
+            error = "no command";
+
+        // Nothing runs unless every command is valid
+        if(error.empty()) {
+            for(commands::Command* command : parsed) {
+                if(!command->execute(conf, ConfigLoadPhase::BIND))
+                    break;
+            }
+        }
+
+        for(commands::Command* command : parsed) delete command;
+
+        Message message(MessageType::COMMAND);
+        message.u8(error.empty());
+        message.str(error);
+        message.finish();
+        return message;
+    }
+}
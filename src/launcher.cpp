@@ -0,0 +1,129 @@
+#include "launcher.hpp"
+
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "scheduling.hpp"
+#include "util.hpp"
+
+extern char** environ;
+
+namespace launcher {
+    // Called by the event loop when a SIGCHLD is received
+    // The signal source uses a signalfd, so this runs as a normal dispatch
+    int handle_sigchld(int signal_number, void* data) {
+        Launcher* launcher = static_cast<Launcher*>(data);
+        launcher->reap();
+        return 0;
+    }
+
+    Launcher::Launcher(wl_display* display)
+        : stats { 0, 0, 0, 0 },
+          // Also blocks SIGCHLD for the main thread, so it's only delivered through the signalfd
+          sigchld_source(wl_event_loop_add_signal(wl_display_get_event_loop(display), SIGCHLD,
+                                                  launcher::handle_sigchld, this)) {
+        if(!sigchld_source)
+            wlr_log(WLR_ERROR, "failed to add SIGCHLD source - children won't be reaped");
+    }
+
+    pid_t Launcher::spawn(const std::string& command) {
+        posix_spawnattr_t attr;
+        posix_spawnattr_init(&attr);
+
+        // The compositor blocks SIGCHLD (and possibly other signals) for its signal
+        // sources, and children would inherit the mask and any ignored signal
+        sigset_t mask;
+        sigemptyset(&mask);
+        posix_spawnattr_setsigmask(&attr, &mask);
+
+        sigset_t defaults;
+        sigfillset(&defaults);
+        posix_spawnattr_setsigdefault(&attr, &defaults);
+
+        short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_SETSID
+        // Detach children from the compositor's session, so they can be
+        // signalled as a group and don't get the compositor's terminal signals
+        flags |= POSIX_SPAWN_SETSID;
+#else
+        flags |= POSIX_SPAWN_SETPGROUP;
+        posix_spawnattr_setpgroup(&attr, 0);
+#endif
+        posix_spawnattr_setflags(&attr, flags);
+
+        const char* argv[] = { "/bin/sh", "-c", command.c_str(), nullptr };
+
+        uint64_t start = now_ns();
+        pid_t pid;
+        int err = posix_spawn(&pid, "/bin/sh", nullptr, &attr, const_cast<char* const*>(argv),
+                              environ);
+        uint64_t latency = now_ns() - start;
+
+        posix_spawnattr_destroy(&attr);
+
+        if(err) {
+            stats.failed++;
+            wlr_log(WLR_ERROR, "failed to spawn '%s': %s", command.c_str(), strerror(err));
+            return -1;
+        }
+
+        stats.launched++;
+        stats.total_latency += latency;
+        if(latency > stats.max_latency)
+            stats.max_latency = latency;
+
+        // posix_spawn can't drop the compositor's priority and affinity by itself
+        scheduling::reset_child(pid);
+        children[pid] = Process { .pid = pid, .command = command, .spawn_time = start };
+
+        wlr_log(WLR_DEBUG, "spawned '%s' (pid %d) in %.1f us", command.c_str(), pid,
+                latency / 1000.0);
+        return pid;
+    }
+
+    bool Launcher::running(pid_t pid) {
+        return children.find(pid) != children.end();
+    }
+
+    void Launcher::terminate(pid_t pid) {
+        if(!running(pid))
+            return;
+
+        // Children lead their own process group, so this also reaches what sh started
+        if(kill(-pid, SIGTERM) < 0 && errno != ESRCH)
+            wlr_log(WLR_ERROR, "failed to terminate pid %d: %s", pid, strerror(errno));
+    }
+
+    void Launcher::reap() {
+        // Only wait on our own children, wlroots may have its own (like Xwayland)
+        for(auto it = children.begin(); it != children.end();) {
+            int status;
+            pid_t ret = waitpid(it->first, &status, WNOHANG);
+
+            if(ret == 0) {
+                ++it;
+                continue;
+            }
+
+            if(ret < 0 && errno != ECHILD) {
+                wlr_log(WLR_ERROR, "waitpid() failed for pid %d: %s", it->first, strerror(errno));
+                ++it;
+                continue;
+            }
+
+            double lifetime = (now_ns() - it->second.spawn_time) / 1e9;
+            if(ret > 0 && WIFEXITED(status))
+                wlr_log(WLR_DEBUG, "'%s' (pid %d) exited with status %d after %.2fs",
+                        it->second.command.c_str(), it->first, WEXITSTATUS(status), lifetime);
+            else if(ret > 0 && WIFSIGNALED(status))
+                wlr_log(WLR_DEBUG, "'%s' (pid %d) killed by signal %d after %.2fs",
+                        it->second.command.c_str(), it->first, WTERMSIG(status), lifetime);
+
+            it = children.erase(it);
+        }
+    }
+}
@@ -2,7 +2,9 @@
 
 #include <cassert>
 
+#include "metrics.hpp"
 #include "server.hpp"
+#include "trace.hpp"
 
 namespace layer_shell {
     void new_surface(wl_listener *listener, void *data) {
@@ -16,6 +18,8 @@ namespace layer_shell {
                 return;
             }
             output::Output *output = server.output_manager.focused_output();
+            if(!output)
+                output = server.output_manager.fallback_output();
             if(output)
                 layer_surface->output = output->output;
             else
@@ -53,6 +57,7 @@ namespace layer_shell {
     }
 
     void surface_commit(wl_listener *listener, void *data) {
+        TRACE_SCOPE("layer_shell::surface_commit");
         LayerSurface *surface = static_cast<wrapper::Listener<LayerSurface> *>(listener)->container;
         bool rearrange = false;
         // HACK
@@ -78,6 +83,7 @@ namespace layer_shell {
     }
 
     void destroy(wl_listener *listener, void *data) {
+        metrics::layer_surfaces_destroyed.inc();
         delete static_cast<wrapper::Listener<LayerSurface> *>(listener)->container;
     }
 
@@ -104,6 +110,7 @@ namespace layer_shell {
           new_popup(this, layer_shell::new_popup, &layer_surface->events.new_popup) {
         layer_surface->data = this;
         tree->node.data = this;
+        metrics::layer_surfaces_created.inc();
     }
 
     void LayerSurface::handle_focus() {
@@ -1,10 +1,17 @@
+#include <pthread.h>
+#include <signal.h>
+
 #include <cstdio>
 #include <cstdlib>
 #include <stdexcept>
+#include <thread>
 
 #include "build-config.h"
 #include "config/config.hpp"
+#include "scheduling.hpp"
 #include "server.hpp"
+#include "startup.hpp"
+#include "util.hpp"
 
 extern "C" {
 #include <getopt.h>
@@ -18,9 +25,13 @@ void usage() {
     printf("    -h              display this help message\n");
     printf("    -v              display debug output\n");
     printf("    -c              set the config file path\n");
+    printf("    -r <priority>   run with SCHED_RR, or a raised nice value if not allowed\n");
+    printf("    -m              lock the compositor's memory\n");
+    printf("    -a <cpus>       pin the compositor to a CPU list like 0,2-3\n");
 }
 
 int main(int argc, char **argv) {
+    startup::begin();
 #ifdef DEBUG
     wlr_log_init(WLR_DEBUG, nullptr);
 #else
@@ -28,9 +39,10 @@ int main(int argc, char **argv) {
 #endif
     char *startup_cmd = nullptr;
     char *config_path = nullptr;
+    scheduling::Options scheduling_options;
 
     int c;
-    while((c = getopt(argc, argv, "c:hv")) != -1) {
+    while((c = getopt(argc, argv, "c:hvr:ma:")) != -1) {
         switch(c) {
             case 'h':
                 usage();
@@ -41,6 +53,21 @@ int main(int argc, char **argv) {
             case 'c':
                 config_path = optarg;
                 break;
+            case 'r':
+                scheduling_options.realtime_priority = atoi(optarg);
+                if(scheduling_options.realtime_priority < sched_get_priority_min(SCHED_RR) ||
+                   scheduling_options.realtime_priority > sched_get_priority_max(SCHED_RR)) {
+                    fprintf(stderr, "realtime priority must be between %d and %d\n",
+                            sched_get_priority_min(SCHED_RR), sched_get_priority_max(SCHED_RR));
+                    exit(1);
+                }
+                break;
+            case 'm':
+                scheduling_options.lock_memory = true;
+                break;
+            case 'a':
+                scheduling_options.affinity = optarg;
+                break;
             default:
                 usage();
                 exit(1);
@@ -52,11 +79,40 @@ int main(int argc, char **argv) {
         exit(1);
     }
 
+    scheduling::apply(scheduling_options);
+
     if(config_path)
         conf.set_config_path(config_path);
 
-    conf.load();
+    // The config file is read while the server brings up the backend and renderer
+    // Signals like SIGUSR2 and SIGCHLD only get their signalfds in Server::create, so the
+    // reader blocks all of them like the workers do, or one could kill the compositor
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    uint64_t read_ns = 0;
+    std::thread config_reader([&read_ns] {
+        uint64_t start = now_ns();
+        conf.read();
+        read_ns = now_ns() - start;
+    });
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+
+    try {
+        Server::create();
+    }
+    catch(const std::runtime_error &err) {
+        config_reader.join();
+        wlr_log(WLR_ERROR, "%s", err.what());
+        wlr_log(WLR_ERROR, "Unrecoverable error. Compositor exiting.");
+        return EXIT_FAILURE;
+    }
+
+    config_reader.join();
+    startup::record("config read", read_ns);
+    conf.import_env();
     conf.execute_phase(ConfigLoadPhase::CONFIG_FIRST_LOAD);
+    startup::mark("config");
 
     try {
         server.start(startup_cmd);
@@ -64,8 +120,10 @@ int main(int argc, char **argv) {
     catch(const std::runtime_error &err) {
         wlr_log(WLR_ERROR, "%s", err.what());
         wlr_log(WLR_ERROR, "Unrecoverable error. Compositor exiting.");
+        Server::destroy();
         return EXIT_FAILURE;
     }
 
+    Server::destroy();
     fflush(stdout);
 }
@@ -0,0 +1,110 @@
+#include "metrics.hpp"
+
+#include <format>
+
+#include "clients.hpp"
+#include "scheduling.hpp"
+#include "server.hpp"
+#include "startup.hpp"
+
+namespace metrics {
+    Counter hit_tests;
+    Counter focus_changes;
+    Counter xdg_configures;
+    Counter toplevels_created;
+    Counter toplevels_destroyed;
+    Counter popups_created;
+    Counter popups_destroyed;
+    Counter layer_surfaces_created;
+    Counter layer_surfaces_destroyed;
+
+    Gauge seat_nodes;
+
+    // Counted when dumping, keeping a gauge up to date would need a listener per node
+    uint64_t scene_nodes(wlr_scene_tree* tree) {
+        uint64_t count = 1;
+
+        wlr_scene_node* node;
+        wl_list_for_each(node, &tree->children, link) {
+            if(node->type == WLR_SCENE_NODE_TREE)
+                count += scene_nodes(wlr_scene_tree_from_node(node));
+            else
+                count++;
+        }
+
+        return count;
+    }
+
+    void header(std::string& out, const char* name, const char* type, const char* help) {
+        out += std::format("# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+    }
+
+    void counter(std::string& out, const char* name, const char* help, const Counter& counter) {
+        header(out, name, "counter", help);
+        out += std::format("{} {}\n", name, counter.get());
+    }
+
+    void gauge(std::string& out, const char* name, const char* help, int64_t value) {
+        header(out, name, "gauge", help);
+        out += std::format("{} {}\n", name, value);
+    }
+
+    std::string dump() {
+        std::string out;
+
+        header(out, "dwc_frames_total", "counter", "Frames committed per output");
+        for(output::Output* output : server.output_manager.outputs)
+            out += std::format("dwc_frames_total{{output=\"{}\"}} {}\n", output->output->name,
+                               output->frames.get());
+
+        header(out, "dwc_output_group_drift_seconds", "gauge",
+               "Delay of the last frame event of an output after the first one of its group");
+        for(output::Output* output : server.output_manager.outputs) {
+            if(!output->group.empty())
+                out += std::format(
+                    "dwc_output_group_drift_seconds{{output=\"{}\",group=\"{}\"}} {}\n",
+                    output->output->name, output->group, output->group_drift_ns / 1e9);
+        }
+
+        header(out, "dwc_client_commits_total", "counter",
+               "Surface commits received per client");
+        for(const auto& [owner, client] : clients::clients)
+            out += std::format("dwc_client_commits_total{{pid=\"{}\"}} {}\n", client->pid,
+                               client->commits);
+
+        counter(out, "dwc_hit_tests_total", "Surface lookups under the cursor", hit_tests);
+        counter(out, "dwc_focus_changes_total", "Keyboard focus changes", focus_changes);
+        counter(out, "dwc_xdg_configures_total", "Configures sent to xdg surfaces",
+                xdg_configures);
+        counter(out, "dwc_toplevels_created_total", "Toplevels created", toplevels_created);
+        counter(out, "dwc_toplevels_destroyed_total", "Toplevels destroyed",
+                toplevels_destroyed);
+        counter(out, "dwc_popups_created_total", "Popups created", popups_created);
+        counter(out, "dwc_popups_destroyed_total", "Popups destroyed", popups_destroyed);
+        counter(out, "dwc_layer_surfaces_created_total", "Layer surfaces created",
+                layer_surfaces_created);
+        counter(out, "dwc_layer_surfaces_destroyed_total", "Layer surfaces destroyed",
+                layer_surfaces_destroyed);
+
+        gauge(out, "dwc_seat_nodes", "Nodes tracked by the seat", seat_nodes.get());
+        // These are read from the compositor state, so they can't drift
+        gauge(out, "dwc_mapped_toplevels", "Toplevels currently mapped", server.toplevels.size());
+        gauge(out, "dwc_workspaces", "Workspaces", server.root.workspaces.size());
+        gauge(out, "dwc_scene_nodes", "Nodes in the scene graph",
+              scene_nodes(&server.root.scene->tree));
+
+        gauge(out, "dwc_realtime_priority", "SCHED_RR priority of the compositor, 0 if not",
+              scheduling::state.policy == SCHED_RR ? scheduling::state.priority : 0);
+        gauge(out, "dwc_nice", "Nice value of the compositor", scheduling::state.nice);
+        gauge(out, "dwc_memory_locked", "Whether the compositor's memory is locked",
+              scheduling::state.memory_locked);
+        gauge(out, "dwc_cpus", "CPUs the compositor can run on", scheduling::state.cpus);
+
+        header(out, "dwc_startup_seconds", "gauge", "Duration of each startup phase");
+        for(const startup::Phase& phase : startup::phases)
+            out += std::format("dwc_startup_seconds{{phase=\"{}\"}} {}\n", phase.name,
+                               phase.duration_ns / 1e9);
+
+        return out;
+    }
+}
@@ -0,0 +1,173 @@
+#include "output-cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+#include "server.hpp"
+
+namespace output_cache {
+    std::unordered_map<std::string, config::OutputConfig> entries;
+    std::filesystem::path path;
+    bool loaded = false;
+
+    // Only one write at a time, a store during a write schedules another one
+    bool writing = false;
+    bool dirty = false;
+
+    // make, model and serial separated by tabs, or empty if the output has none of them
+    // Without a serial, identical monitors and nested outputs are told apart by connector
+    std::string key(wlr_output* output) {
+        std::string key;
+        bool identified = false;
+
+        const char* serial = output->serial && *output->serial ? output->serial : output->name;
+        for(const char* part : { output->make, output->model, serial }) {
+            std::string value = part ? part : "";
+            std::replace(value.begin(), value.end(), '\t', ' ');
+            std::replace(value.begin(), value.end(), '\n', ' ');
+
+            identified |= !value.empty();
+            key += value;
+            key += '\t';
+        }
+
+        key.pop_back();
+        return identified ? key : "";
+    }
+
+    void load() {
+        loaded = true;
+
+        if(const char* state_home = getenv("XDG_STATE_HOME"); state_home && *state_home)
+            path = std::filesystem::path(state_home) / "dwc/output-cache";
+        else if(const char* home = getenv("HOME"); home && *home)
+            path = std::filesystem::path(home) / ".local/state/dwc/output-cache";
+        else
+            return;
+
+        std::ifstream file(path);
+        std::string line;
+        while(std::getline(file, line)) {
+            // The state comes after the last tab
+            size_t tab = line.rfind('\t');
+            if(tab == std::string::npos)
+                continue;
+
+            config::OutputConfig entry;
+            Mode mode;
+            Position pos;
+            int refresh, transform, adaptive_sync;
+            // Older caches don't have the positioned field, all their positions were kept
+            int positioned = 1;
+            int fields = sscanf(line.c_str() + tab + 1, "%d %d %d %d %d %lf %d %d %d",
+                                &mode.width, &mode.height, &refresh, &pos.x, &pos.y,
+                                &entry.scale, &transform, &adaptive_sync, &positioned);
+            if(fields < 8 || transform < WL_OUTPUT_TRANSFORM_NORMAL ||
+               transform > WL_OUTPUT_TRANSFORM_FLIPPED_270)
+                continue;
+
+            mode.refresh_rate = refresh / 1000.0;
+            entry.mode = mode;
+            if(positioned)
+                entry.pos = pos;
+            entry.transform = static_cast<wl_output_transform>(transform);
+            entry.adaptive_sync = adaptive_sync;
+
+            entries.insert_or_assign(line.substr(0, tab), entry);
+        }
+
+        wlr_log(WLR_DEBUG, "loaded %zu cached output states from %s", entries.size(),
+                path.c_str());
+    }
+
+    void write_file(const std::filesystem::path& path, const std::string& text) {
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path(), ec);
+
+        // Written next to it and renamed, so a crash never leaves a truncated cache
+        std::filesystem::path tmp = path;
+        tmp += ".tmp";
+        std::ofstream file(tmp, std::ios::trunc);
+        file << text;
+        file.close();
+
+        if(file)
+            std::filesystem::rename(tmp, path, ec);
+        if(!file || ec)
+            wlr_log(WLR_ERROR, "failed to write the output cache %s", path.c_str());
+    }
+
+    void write() {
+        if(writing) {
+            dirty = true;
+            return;
+        }
+
+        writing = true;
+        dirty = false;
+
+        std::string text;
+        for(const auto& [key, entry] : entries)
+            text += std::format("{}\t{} {} {} {} {} {} {} {} {}\n", key, entry.mode->width,
+                                entry.mode->height, std::lround(entry.mode->refresh_rate * 1000),
+                                entry.pos ? entry.pos->x : 0, entry.pos ? entry.pos->y : 0,
+                                entry.scale, (int)entry.transform, (int)entry.adaptive_sync,
+                                (int)entry.pos.has_value());
+
+        server.workers.submit([file = path, text = std::move(text)] { write_file(file, text); },
+                              [] {
+                                  writing = false;
+                                  if(dirty)
+                                      write();
+                              });
+    }
+
+    std::optional<config::OutputConfig> lookup(wlr_output* output) {
+        if(!loaded)
+            load();
+
+        auto it = entries.find(key(output));
+        if(it == entries.end())
+            return std::nullopt;
+
+        return it->second;
+    }
+
+    void store(wlr_output* output, bool positioned) {
+        if(!loaded)
+            load();
+
+        std::string name = key(output);
+        if(name.empty() || !output->enabled)
+            return;
+
+        config::OutputConfig entry;
+        entry.mode = Mode { .width = output->width,
+                            .height = output->height,
+                            .refresh_rate = output->refresh / 1000.0 };
+        // Automatically placed outputs stay automatic
+        if(positioned) {
+            wlr_box box;
+            wlr_output_layout_get_box(server.root.output_layout, output, &box);
+            entry.pos = Position { box.x, box.y };
+        }
+        entry.transform = output->transform;
+        entry.scale = output->scale;
+        entry.adaptive_sync = output->adaptive_sync_status == WLR_OUTPUT_ADAPTIVE_SYNC_ENABLED;
+
+        auto it = entries.find(name);
+        if(it != entries.end() && it->second == entry)
+            return;
+
+        entries.insert_or_assign(name, entry);
+        if(!path.empty())
+            write();
+    }
+}
@@ -4,10 +4,18 @@
 #include <cassert>
 #include <iostream>
 #include <map>
+#include <vector>
 
+#include "background.hpp"
+#include "clients.hpp"
+#include "frame-pacing.hpp"
 #include "layer-shell.hpp"
+#include "output-cache.hpp"
 #include "root.hpp"
 #include "server.hpp"
+#include "startup.hpp"
+#include "trace.hpp"
+#include "util.hpp"
 
 namespace output {
     void new_output(wl_listener *listener, void *data) {
@@ -28,13 +36,19 @@ namespace output {
             wlr_output_layout_get_box(server.root.output_layout, output->output, &output_box);
 
             // Mark the output enabled if it's swithed off but not disabled
-            config_head->state.enabled = !wlr_box_empty(&output_box);
+            // Mirrors aren't in the layout, so clients applying this config would disable them
+            if(!output->mirror_name.empty())
+                config_head->state.enabled = output->output->enabled;
+            else
+                config_head->state.enabled = !wlr_box_empty(&output_box);
             config_head->state.x = output_box.x;
             config_head->state.y = output_box.y;
         }
 
         // Update the configuration
         wlr_output_manager_v1_set_configuration(server.output_manager_v1, config);
+
+        server.ipc.notify(ipc::SUBSCRIBE_OUTPUT);
     }
 
     void output_test(wl_listener *listener, void *data) {
@@ -47,18 +61,84 @@ namespace output {
                                                   false);
     }
 
+    // Called when a client like an idle daemon turns an output on or off
+    // Only the output is toggled, it keeps its place in the layout, its workspaces and mode
+    void output_power_set_mode(wl_listener *listener, void *data) {
+        const wlr_output_power_v1_set_mode_event *event =
+            static_cast<wlr_output_power_v1_set_mode_event *>(data);
+        Output *output = static_cast<Output *>(event->output->data);
+        bool on = event->mode == ZWLR_OUTPUT_POWER_V1_MODE_ON;
+        if(!output || event->output->enabled == on)
+            return;
+
+        wlr_output_state state;
+        wlr_output_state_init(&state);
+        wlr_output_state_set_enabled(&state, on);
+        if(!wlr_output_commit_state(event->output, &state))
+            wlr_log(WLR_ERROR, "failed to power %s output %s", on ? "on" : "off",
+                    event->output->name);
+        wlr_output_state_finish(&state);
+
+        if(on)
+            wlr_output_schedule_frame(event->output);
+        if(!output->group.empty())
+            server.output_manager.wake_group(output->group);
+        server.ipc.notify(ipc::SUBSCRIBE_OUTPUT);
+    }
+
+    struct FrameDone {
+        wlr_scene_output *scene_output;
+        timespec when;
+        uint64_t when_ns;
+    };
+
+    // Same as wlr_scene_output_send_frame_done, but throttled clients can skip frames
+    void send_frame_done(wlr_scene_buffer *buffer, int sx, int sy, void *data) {
+        FrameDone *frame_done = static_cast<FrameDone *>(data);
+        if(buffer->primary_output != frame_done->scene_output)
+            return;
+
+        wlr_scene_surface *scene_surface = wlr_scene_surface_try_from_buffer(buffer);
+        if(scene_surface && !clients::send_frame_done(scene_surface->surface, frame_done->when_ns))
+            return;
+
+        wlr_scene_buffer_send_frame_done(buffer, &frame_done->when);
+    }
+
+    void frame_done(Output *output) {
+        FrameDone frame_done = { .scene_output = output->scene_output };
+        clock_gettime(CLOCK_MONOTONIC, &frame_done.when);
+        frame_done.when_ns = frame_done.when.tv_sec * 1000000000ull + frame_done.when.tv_nsec;
+        wlr_scene_output_for_each_buffer(output->scene_output, send_frame_done, &frame_done);
+    }
+
     // Called whenever an output wants to display a frame
     // Generally should be at the output's refresh rate
     void frame(wl_listener *listener, void *data) {
+        TRACE_SCOPE("output::frame");
         Output *output = static_cast<wrapper::Listener<Output> *>(listener)->container;
-        wlr_scene *scene = server.root.scene;
-        wlr_scene_output *scene_output = wlr_scene_get_scene_output(scene, output->output);
-
-        wlr_scene_output_commit(scene_output, nullptr);
+        xdg_shell::flush_foreign_toplevels();
+        // Scheduled frames still come for powered off outputs, their surfaces get no callbacks
+        if(!output->output->enabled)
+            return;
+        if(!output->scene_output) {
+            output->draw_mirror();
+            return;
+        }
+        // Held commits that are ready make it into this frame
+        frame_pacing::frame(output->output);
+        if(!output->group.empty()) {
+            server.output_manager.group_frame(output);
+            return;
+        }
 
-        timespec now;
-        clock_gettime(CLOCK_MONOTONIC, &now);
-        wlr_scene_output_send_frame_done(scene_output, &now);
+        // Frames without damage commit nothing, so they aren't counted
+        if(wlr_scene_output_needs_frame(output->scene_output) &&
+           wlr_scene_output_commit(output->scene_output, nullptr)) {
+            output->frames.inc();
+            startup::mark("first frame");
+        }
+        frame_done(output);
     }
 
     // Called when the backend request a new state
@@ -69,9 +149,11 @@ namespace output {
             static_cast<wlr_output_event_request_state *>(data);
 
         wlr_output_commit_state(output->output, event->state);
+        server.ipc.notify(ipc::SUBSCRIBE_OUTPUT);
 
         output->arrange_layers();
         output->update_position();
+        background::update(output);
         server.root.arrange();
 
         for(auto &ws : output->workspaces) {
@@ -80,22 +162,54 @@ namespace output {
         }
     }
 
+    // Called after every commit, keeps the last buffer around for mirrors of this output
+    void commit(wl_listener *listener, void *data) {
+        Output *output = static_cast<wrapper::Listener<Output> *>(listener)->container;
+        const wlr_output_event_commit *event = static_cast<wlr_output_event_commit *>(data);
+        if(!(event->state->committed & WLR_OUTPUT_STATE_BUFFER))
+            return;
+
+        bool mirrored = false;
+        for(Output *mirror : server.output_manager.outputs) {
+            if(mirror->mirror_source == output) {
+                mirrored = true;
+                wlr_output_schedule_frame(mirror->output);
+            }
+        }
+
+        if(output->buffer)
+            wlr_buffer_unlock(output->buffer);
+        output->buffer = mirrored ? wlr_buffer_lock(event->state->buffer) : nullptr;
+        output->buffer_seq++;
+    }
+
     // Called when an output is destroyed
     void output_destroy(wl_listener *listener, void *data) {
         Output *output = static_cast<wrapper::Listener<Output> *>(listener)->container;
         server.output_manager.outputs.remove(output);
         delete output;
+
+        server.ipc.notify(ipc::SUBSCRIBE_OUTPUT | ipc::SUBSCRIBE_WORKSPACE);
     }
 
     Output::Output(wlr_output *output)
         : output(output),
           // Adds output to scene graph
           scene_output(wlr_scene_output_create(server.root.scene, output)),
+          mirror_source(nullptr),
+          group_drift_ns(0),
+          background(nullptr),
           active_workspace(nullptr),
 
           frame(this, output::frame, &output->events.frame),
           request_state(this, output::request_state, &output->events.request_state),
-          destroy(this, output::output_destroy, &output->events.destroy) {
+          commit(this, output::commit, &output->events.commit),
+          destroy(this, output::output_destroy, &output->events.destroy),
+          buffer(nullptr),
+          buffer_seq(0),
+          mirrored_seq(0),
+          frame_pending(false),
+          frame_ns(0) {
         output->data = this;
 
         // Configures the output to use our allocator and renderer
@@ -112,7 +226,17 @@ namespace output {
         if(conf.output_config.find(output->name) != conf.output_config.end())
             config = &conf.output_config[output->name];
 
-        bool success = config && apply_config(config, false);
+        // Each candidate state is tested first, so hotplugging takes a single modeset
+        // An explicit config wins over the last state that worked on this monitor
+        std::optional<config::OutputConfig> cached = output_cache::lookup(output);
+        bool success = false;
+        if(config && apply_config(config, true))
+            success = apply_config(config, false);
+        else if(cached && apply_config(&cached.value(), true)) {
+            wlr_log(WLR_INFO, "using the cached state for output %s", output->name);
+            success = apply_config(&cached.value(), false);
+        }
+
         if(!success) {
             wlr_log(WLR_INFO, "using fallback config for output %s", output->name);
 
@@ -120,7 +244,8 @@ namespace output {
             wlr_output_state_init(&state);
 
             wlr_output_state_set_enabled(&state, true);
-            wlr_output_state_set_mode(&state, wlr_output_preferred_mode(output));
+            if(wlr_output_preferred_mode(output))
+                wlr_output_state_set_mode(&state, wlr_output_preferred_mode(output));
 
             success = wlr_output_commit_state(output, &state);
             wlr_output_state_finish(&state);
@@ -134,21 +259,54 @@ namespace output {
                 // Add output to scene output layout
                 wlr_scene_output_layout_add_output(server.scene_layout, layout_output,
                                                    scene_output);
+                output_cache::store(output, false);
             }
         }
 
+        if(success)
+            startup::mark("first modeset");
+        // The config's background still applies when its state didn't work
+        if(config && background_config != config->background) {
+            background_config = config->background;
+            background::update(this);
+        }
+
         arrange_layers();
         update_position();
 
-        workspaces.push_back(new workspace::Workspace(this));
-        active_workspace = workspaces.front();
-        workspaces.front()->switch_focus();
+        // Mirrors show the workspaces of their source
+        if(mirror_name.empty()) {
+            workspaces.push_back(new workspace::Workspace(this));
+            active_workspace = workspaces.front();
+            workspaces.front()->switch_focus();
+        }
 
+        // This may be the source of outputs that were already mirroring its name
+        server.output_manager.update_mirrors();
         server.root.arrange();
     }
 
     Output::~Output() {
-        for(const auto &ws : workspaces) delete ws;
+        background::remove(this);
+        // Unplugged outputs don't take their windows with them if another output can show
+        // them, this output already left the list
+        server.output_manager.move_workspaces(this);
+        for(const auto &ws : workspaces) {
+            server.root.workspaces.erase(ws->id);
+            delete ws;
+        }
+
+        // The source's cursor lock only has to be released while it's still alive
+        for(Output *mirror : server.output_manager.outputs) {
+            if(mirror->mirror_source == this)
+                mirror->mirror_source = nullptr;
+        }
+        if(mirror_source)
+            wlr_output_lock_software_cursors(mirror_source->output, false);
+        if(buffer)
+            wlr_buffer_unlock(buffer);
+        if(!group.empty())
+            server.output_manager.wake_group(group);
     }
 
     void Output::update_position() {
@@ -199,10 +357,17 @@ namespace output {
                     wlr_output_state_set_mode(&state, best_mode);
                     mode_set = true;
                 }
+                // Headless and nested outputs don't have a mode list, any mode works
+                else if(wl_list_empty(&output->modes)) {
+                    wlr_output_state_set_custom_mode(&state, config_mode.width,
+                                                     config_mode.height,
+                                                     (int)(config_mode.refresh_rate * 1000));
+                    mode_set = true;
+                }
             }
 
             // set to preferred mode if not set
-            if(!mode_set) {
+            if(!mode_set && wlr_output_preferred_mode(output)) {
                 wlr_output_state_set_mode(&state, wlr_output_preferred_mode(output));
                 wlr_log(WLR_INFO, "using fallback mode for output %s", output->name);
             }
@@ -224,11 +389,49 @@ namespace output {
         else {
             success = wlr_output_commit_state(output, &state);
             if(success) {
-                if(config->pos.has_value())
-                    wlr_output_layout_add(server.root.output_layout, output, config->pos->x,
-                                          config->pos->y);
-                else
-                    wlr_output_layout_add_auto(server.root.output_layout, output);
+                server.ipc.notify(ipc::SUBSCRIBE_OUTPUT);
+                bool was_mirror = !mirror_name.empty();
+                mirror_name = config->mirror.value_or("");
+                std::string old_group = group;
+                group = config->group.value_or("");
+                frame_pending = false;
+                if(!old_group.empty())
+                    server.output_manager.wake_group(old_group);
+                // Layer surfaces of mirrors would be drawn over the output at their empty
+                // box's position
+                for(wlr_scene_tree *tree : { layers.shell_background, layers.shell_bottom,
+                                             layers.shell_top, layers.shell_overlay })
+                    wlr_scene_node_set_enabled(&tree->node, !config->mirror);
+
+                if(config->mirror) {
+                    // Same for the windows, while the box still has the old position
+                    server.output_manager.move_workspaces(this);
+                    // Mirrors aren't part of the layout and never render the scene, so the
+                    // scene doesn't pick them as the primary output of any surface
+                    wlr_output_layout_remove(server.root.output_layout, output);
+                    if(scene_output) {
+                        wlr_scene_output_destroy(scene_output);
+                        scene_output = nullptr;
+                    }
+                }
+                else {
+                    if(!scene_output)
+                        scene_output = wlr_scene_output_create(server.root.scene, output);
+                    if(was_mirror && workspaces.empty()) {
+                        active_workspace = new workspace::Workspace(this);
+                        active_workspace->active = true;
+                        workspaces.push_back(active_workspace);
+                    }
+                    if(config->pos.has_value())
+                        wlr_output_layout_add(server.root.output_layout, output, config->pos->x,
+                                              config->pos->y);
+                    else
+                        wlr_output_layout_add_auto(server.root.output_layout, output);
+                    output_cache::store(output, config->pos.has_value());
+                }
+                server.output_manager.update_mirrors();
+                background_config = config->background;
+                background::update(this);
             }
         }
 
@@ -236,6 +439,90 @@ namespace output {
         return success;
     }
 
+    void Output::damage_whole() {
+        if(!scene_output)
+            return;
+
+        // Damage the scene output the same way wlroots does for software cursors, scheduling
+        // a frame alone adds no damage, so a static scene wouldn't commit a buffer
+        pixman_region32_t damage;
+        pixman_region32_init_rect(&damage, 0, 0, output->width, output->height);
+        wlr_output_event_damage event = { .output = output, .damage = &damage };
+        wl_signal_emit_mutable(&output->events.damage, &event);
+        pixman_region32_fini(&damage);
+    }
+
+    void Output::draw_mirror() {
+        if(!mirror_source || !mirror_source->buffer || mirror_source->buffer_seq == mirrored_seq)
+            return;
+        wlr_buffer *source_buffer = mirror_source->buffer;
+        mirrored_seq = mirror_source->buffer_seq;
+
+        wlr_output_state state;
+        wlr_output_state_init(&state);
+
+        // With the same size and transform the source's buffer is scanned out as is
+        bool direct = source_buffer->width == output->width &&
+                      source_buffer->height == output->height &&
+                      mirror_source->output->transform == output->transform;
+        if(direct) {
+            wlr_output_state_set_buffer(&state, source_buffer);
+            direct = wlr_output_test_state(output, &state);
+            if(!direct) {
+                wlr_output_state_finish(&state);
+                wlr_output_state_init(&state);
+            }
+        }
+
+        if(direct || render_mirror(&state, source_buffer)) {
+            if(wlr_output_commit_state(output, &state))
+                frames.inc();
+        }
+        wlr_output_state_finish(&state);
+    }
+
+    bool Output::render_mirror(wlr_output_state *state, wlr_buffer *source_buffer) {
+        wlr_texture *texture = wlr_texture_from_buffer(server.renderer, source_buffer);
+        if(!texture)
+            return false;
+
+        wlr_render_pass *pass = wlr_output_begin_render_pass(output, state, nullptr);
+        if(!pass) {
+            wlr_texture_destroy(texture);
+            return false;
+        }
+
+        // Fits the source in the mirror keeping its aspect ratio, centered between black bars
+        int source_width, source_height, width, height;
+        wlr_output_transformed_resolution(mirror_source->output, &source_width, &source_height);
+        wlr_output_transformed_resolution(output, &width, &height);
+        double ratio = std::min((double)width / source_width, (double)height / source_height);
+
+        wlr_box box = { .width = (int)(source_width * ratio),
+                        .height = (int)(source_height * ratio) };
+        box.x = (width - box.width) / 2;
+        box.y = (height - box.height) / 2;
+
+        wlr_render_rect_options background = {};
+        background.box = { .width = output->width, .height = output->height };
+        background.color = { .r = 0, .g = 0, .b = 0, .a = 1 };
+        wlr_render_pass_add_rect(pass, &background);
+
+        // The source buffer is in the source's physical orientation, the pass in the mirror's
+        wlr_render_texture_options options = {};
+        options.texture = texture;
+        wlr_box_transform(&options.dst_box, &box, wlr_output_transform_invert(output->transform),
+                          width, height);
+        options.transform = wlr_output_transform_compose(
+            wlr_output_transform_invert(mirror_source->output->transform), output->transform);
+        options.filter_mode = WLR_SCALE_FILTER_BILINEAR;
+        wlr_render_pass_add_texture(pass, &options);
+
+        bool success = wlr_render_pass_submit(pass);
+        wlr_texture_destroy(texture);
+        return success;
+    }
+
     wlr_scene_tree *Output::get_scene(zwlr_layer_shell_v1_layer type) {
         switch(type) {
             case ZWLR_LAYER_SHELL_V1_LAYER_BACKGROUND:
@@ -285,15 +572,26 @@ namespace output {
         out->output_manager_destroy.free();
     }
 
+    void output_power_manager_destroy(wl_listener *listener, void *data) {
+        OutputManager *out = static_cast<wrapper::Listener<OutputManager> *>(listener)->container;
+        out->output_power_set_mode.free();
+        out->output_power_manager_destroy.free();
+    }
+
     OutputManager::OutputManager(wl_display *display)
-        : layout_update(this, output::layout_update, &server.root.output_layout->events.change),
+        : headless(nullptr),
+          layout_update(this, output::layout_update, &server.root.output_layout->events.change),
           output_test(this, output::output_test, &server.output_manager_v1->events.test),
           output_apply(this, output::output_apply, &server.output_manager_v1->events.apply),
+          output_power_set_mode(this, output::output_power_set_mode,
+                                &server.output_power_manager_v1->events.set_mode),
 
           output_layout_destroy(this, output::output_layout_destroy,
                                 &server.root.output_layout->events.destroy),
           output_manager_destroy(this, output::output_manager_destroy,
-                                 &server.output_manager_v1->events.destroy) {}
+                                 &server.output_manager_v1->events.destroy),
+          output_power_manager_destroy(this, output::output_power_manager_destroy,
+                                       &server.output_power_manager_v1->events.destroy) {}
 
     Output *OutputManager::output_at(double x, double y) {
         wlr_output *output = wlr_output_layout_output_at(server.root.output_layout, x, y);
@@ -307,10 +605,56 @@ namespace output {
         return output_at(cursor->x, cursor->y);
     }
 
+    Output *OutputManager::fallback_output(Output *except) {
+        for(Output *output : outputs) {
+            if(output != except && output->scene_output && output->active_workspace)
+                return output;
+        }
+        return nullptr;
+    }
+
+    bool OutputManager::move_workspaces(Output *from) {
+        if(from->workspaces.empty())
+            return true;
+
+        Output *to = fallback_output(from);
+        if(!to)
+            return false;
+
+        for(workspace::Workspace *ws : from->workspaces) {
+            ws->output = to;
+            ws->active = false;
+            for(xdg_shell::Toplevel *toplevel : ws->floating) {
+                // Same place relative to the output
+                toplevel->set_position(
+                    toplevel->scene_tree->node.x - from->output_box.x + to->output_box.x,
+                    toplevel->scene_tree->node.y - from->output_box.y + to->output_box.y);
+                wlr_scene_node_set_enabled(&toplevel->scene_tree->node, false);
+            }
+            if(ws->fullscreen && ws->focused_toplevel)
+                ws->focused_toplevel->update_fullscreen();
+            to->workspaces.push_back(ws);
+        }
+        from->workspaces.clear();
+        from->active_workspace = nullptr;
+
+        server.idle.update_inhibited();
+        server.ipc.notify(ipc::SUBSCRIBE_WORKSPACE);
+        return true;
+    }
+
     void OutputManager::apply_output_config(wlr_output_configuration_v1 *config, bool test) {
         struct wlr_output_configuration_head_v1 *config_head;
         wl_list_for_each(config_head, &config->heads, link) {
-            conf.output_config[config_head->state.output->name] = config::OutputConfig(config_head);
+            // wlr-output-management doesn't know about mirrors, groups or backgrounds, they
+            // stay as configured
+            config::OutputConfig &oc = conf.output_config[config_head->state.output->name];
+            std::optional<std::string> mirror = oc.mirror, group = oc.group;
+            std::optional<config::Background> background = oc.background;
+            oc = config::OutputConfig(config_head);
+            oc.mirror = mirror;
+            oc.group = group;
+            oc.background = background;
         }
 
         // Apply configs
@@ -327,10 +671,179 @@ namespace output {
             }
         }
 
+        if(!test)
+            update_mirrors();
+
         // Send config status
         if(success)
             wlr_output_configuration_v1_send_succeeded(config);
         else
             wlr_output_configuration_v1_send_failed(config);
     }
+
+    void OutputManager::update_mirrors() {
+        for(Output *mirror : outputs) {
+            Output *source = nullptr;
+            if(!mirror->mirror_name.empty()) {
+                for(Output *output : outputs) {
+                    if(output != mirror && mirror->mirror_name == output->output->name)
+                        source = output;
+                }
+            }
+            if(source == mirror->mirror_source)
+                continue;
+
+            // The cursor is a hardware plane that isn't part of the source's buffer,
+            // so sources of mirrors draw it in software
+            if(mirror->mirror_source)
+                wlr_output_lock_software_cursors(mirror->mirror_source->output, false);
+            mirror->mirror_source = source;
+            mirror->mirrored_seq = 0;
+            if(source) {
+                wlr_output_lock_software_cursors(source->output, true);
+                source->damage_whole();
+            }
+        }
+    }
+
+    void OutputManager::group_frame(Output *output) {
+        output->frame_pending = true;
+        output->frame_ns = now_ns();
+
+        std::vector<Output *> members;
+        for(Output *member : outputs) {
+            if(member->group == output->group && member->scene_output && member->output->enabled)
+                members.push_back(member);
+        }
+
+        // The group follows the frame clock of whichever output is the latest, the others
+        // get a frame scheduled in case they had nothing to draw
+        bool ready = true;
+        for(Output *member : members) {
+            if(!member->frame_pending) {
+                ready = false;
+                wlr_output_schedule_frame(member->output);
+            }
+        }
+        if(!ready)
+            return;
+
+        TRACE_SCOPE("output::group_frame");
+        uint64_t first_ns = UINT64_MAX;
+        for(Output *member : members)
+            first_ns = std::min(first_ns, member->frame_ns);
+
+        std::vector<wlr_backend_output_state> states;
+        states.reserve(members.size());
+        for(Output *member : members) {
+            member->frame_pending = false;
+            member->group_drift_ns = member->frame_ns - first_ns;
+            if(!wlr_scene_output_needs_frame(member->scene_output))
+                continue;
+
+            wlr_backend_output_state &state = states.emplace_back();
+            state.output = member->output;
+            wlr_output_state_init(&state.base);
+            if(!wlr_scene_output_build_state(member->scene_output, &state.base, nullptr)) {
+                wlr_output_state_finish(&state.base);
+                states.pop_back();
+            }
+        }
+
+        // One commit for the whole group, which the DRM backend turns into a single atomic
+        // commit when the outputs are on the same device
+        bool together =
+            !states.empty() && wlr_backend_commit(server.backend, states.data(), states.size());
+        if(!states.empty() && !together)
+            wlr_log(WLR_DEBUG, "outputs of group %s committed separately", output->group.c_str());
+
+        for(wlr_backend_output_state &state : states) {
+            if(together || wlr_output_commit_state(state.output, &state.base)) {
+                static_cast<Output *>(state.output->data)->frames.inc();
+                startup::mark("first frame");
+            }
+            wlr_output_state_finish(&state.base);
+        }
+
+        for(Output *member : members)
+            frame_done(member);
+    }
+
+    void OutputManager::wake_group(const std::string &group) {
+        for(Output *member : outputs) {
+            if(member->group == group)
+                wlr_output_schedule_frame(member->output);
+        }
+    }
+
+    Output *OutputManager::create_headless(const Mode &mode) {
+        if(!headless) {
+            if(!wlr_backend_is_multi(server.backend)) {
+                wlr_log(WLR_ERROR, "can't add a headless backend to a single backend");
+                return nullptr;
+            }
+
+            headless = wlr_headless_backend_create(wl_display_get_event_loop(server.display));
+            if(!headless) {
+                wlr_log(WLR_ERROR, "failed to create the headless backend");
+                return nullptr;
+            }
+            wlr_multi_backend_add(server.backend, headless);
+
+            // The multi backend only starts the backends it had when it was started
+            if(!wlr_backend_start(headless)) {
+                wlr_log(WLR_ERROR, "failed to start the headless backend");
+                wlr_multi_backend_remove(server.backend, headless);
+                wlr_backend_destroy(headless);
+                headless = nullptr;
+                return nullptr;
+            }
+        }
+
+        // new_output sets it up like any other output, then it gets the requested mode
+        wlr_output *wlr_output = wlr_headless_add_output(headless, mode.width, mode.height);
+        if(!wlr_output) {
+            wlr_log(WLR_ERROR, "failed to create a headless output");
+            return nullptr;
+        }
+        Output *output = static_cast<Output *>(wlr_output->data);
+
+        config::OutputConfig &config = conf.output_config[wlr_output->name];
+        config.mode = mode;
+        if(!output->apply_config(&config, false))
+            wlr_log(WLR_ERROR, "failed to set the mode of output %s", wlr_output->name);
+        output->arrange_layers();
+        output->update_position();
+        server.root.arrange();
+
+        wlr_log(WLR_INFO, "created headless output %s", wlr_output->name);
+        return output;
+    }
+
+    bool OutputManager::destroy_headless(const std::string &name) {
+        for(Output *output : outputs) {
+            if(name != output->output->name)
+                continue;
+
+            if(!wlr_output_is_headless(output->output)) {
+                wlr_log(WLR_ERROR, "output %s isn't headless", name.c_str());
+                return false;
+            }
+
+            // Toplevels keep pointers to their workspace, which must outlive the output
+            if(!server.output_manager.move_workspaces(output)) {
+                wlr_log(WLR_ERROR, "can't destroy %s, no other output can take its workspaces",
+                        name.c_str());
+                return false;
+            }
+
+            // Headless output names are never reused
+            wlr_output_destroy(output->output);
+            conf.output_config.erase(name);
+            return true;
+        }
+
+        wlr_log(WLR_ERROR, "no output called %s", name.c_str());
+        return false;
+    }
 }
@@ -1,6 +1,7 @@
 #include "root.hpp"
 
 #include "server.hpp"
+#include "trace.hpp"
 
 nodes::Node::Node(xdg_shell::Toplevel* toplevel)
     : type(NodeType::TOPLEVEL) {
@@ -33,11 +34,13 @@ nodes::Root::Root(wl_display* display)
       shell_overlay(wlr_scene_tree_create(&scene->tree)),
       layer_popups(wlr_scene_tree_create(&scene->tree)),
       fullscreen(wlr_scene_tree_create(&scene->tree)),
+      unmanaged(wlr_scene_tree_create(&scene->tree)),
       seat(wlr_scene_tree_create(&scene->tree)) {
     wl_signal_init(&events.new_node);
 }
 
 void nodes::Root::arrange() {
+    TRACE_SCOPE("root::arrange");
     wlr_scene_node_set_enabled(&shell_background->node, true);
     wlr_scene_node_set_enabled(&shell_bottom->node, true);
     wlr_scene_node_set_enabled(&floating->node, true);
@@ -45,8 +48,9 @@ void nodes::Root::arrange() {
     wlr_scene_node_set_enabled(&shell_overlay->node, true);
 
     for(auto& output : server.output_manager.outputs) {
-        wlr_scene_output_set_position(output->scene_output, output->output_box.x,
-                                      output->output_box.y);
+        if(output->scene_output)
+            wlr_scene_output_set_position(output->scene_output, output->output_box.x,
+                                          output->output_box.y);
 
         /*wlr_scene_node_reparent(&output->layers.shell_background->node, shell_background);*/
         /*wlr_scene_node_reparent(&output->layers.shell_bottom->node, shell_bottom);*/
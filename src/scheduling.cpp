@@ -0,0 +1,155 @@
+#include "scheduling.hpp"
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+
+#include "wlr.hpp"
+
+namespace scheduling {
+    // Used when SCHED_RR isn't allowed
+    constexpr int FALLBACK_NICE = -10;
+
+    State state = { SCHED_OTHER, 0, 0, false, 0 };
+
+    // What the compositor started with, given back to its children
+    int initial_nice = 0;
+    cpu_set_t initial_cpus;
+    bool nice_changed = false;
+    bool affinity_changed = false;
+
+    bool parse_cpu(std::string_view s, int& cpu) {
+        auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), cpu);
+        return !s.empty() && ec == std::errc() && ptr == s.data() + s.size() && cpu >= 0 &&
+               cpu < CPU_SETSIZE;
+    }
+
+    bool parse_cpus(std::string_view list, cpu_set_t& cpus) {
+        CPU_ZERO(&cpus);
+
+        while(!list.empty()) {
+            size_t comma = list.find(',');
+            std::string_view range = list.substr(0, comma);
+            list = comma == std::string_view::npos ? "" : list.substr(comma + 1);
+
+            size_t dash = range.find('-');
+            int first, last;
+            if(!parse_cpu(range.substr(0, dash), first))
+                return false;
+            if(dash == std::string_view::npos)
+                last = first;
+            else if(!parse_cpu(range.substr(dash + 1), last) || last < first)
+                return false;
+
+            for(int cpu = first; cpu <= last; cpu++) CPU_SET(cpu, &cpus);
+        }
+
+        return CPU_COUNT(&cpus) > 0;
+    }
+
+    void set_realtime(int priority) {
+        sched_param param = { .sched_priority = priority };
+        // Worker threads and children don't inherit it
+        if(sched_setscheduler(0, SCHED_RR | SCHED_RESET_ON_FORK, &param) == 0)
+            return;
+
+        wlr_log(WLR_INFO, "SCHED_RR not allowed (%s), raising the nice value instead",
+                strerror(errno));
+
+        // Without CAP_SYS_NICE, RLIMIT_NICE allows going down to 20 - limit
+        int target = FALLBACK_NICE;
+        rlimit limit;
+        if(getrlimit(RLIMIT_NICE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY &&
+           geteuid() != 0)
+            target = std::max(target, 20 - (int)limit.rlim_cur);
+
+        if(target >= initial_nice || setpriority(PRIO_PROCESS, 0, target) < 0) {
+            wlr_log(WLR_INFO, "not allowed to raise the priority, keeping the default");
+            return;
+        }
+
+        nice_changed = true;
+    }
+
+    void lock_memory() {
+        int flags = MCL_CURRENT;
+#ifdef MCL_ONFAULT
+        // Pages get locked as they're used, instead of faulting everything in now
+        flags |= MCL_ONFAULT;
+#endif
+
+        // With a limited RLIMIT_MEMLOCK, locking future mappings would make
+        // allocations fail once the limit is reached
+        rlimit limit;
+        if(geteuid() == 0 ||
+           (getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur == RLIM_INFINITY))
+            flags |= MCL_FUTURE;
+        else
+            wlr_log(WLR_INFO, "RLIMIT_MEMLOCK is limited, only locking the current mappings");
+
+        if(mlockall(flags) < 0) {
+            wlr_log(WLR_INFO, "failed to lock memory: %s", strerror(errno));
+            return;
+        }
+
+        state.memory_locked = true;
+    }
+
+    void set_affinity(const std::string& affinity) {
+        cpu_set_t cpus;
+        if(!parse_cpus(affinity, cpus)) {
+            wlr_log(WLR_ERROR, "invalid CPU list '%s', keeping the default affinity",
+                    affinity.c_str());
+            return;
+        }
+
+        if(sched_setaffinity(0, sizeof(cpus), &cpus) < 0) {
+            wlr_log(WLR_INFO, "failed to set the CPU affinity: %s", strerror(errno));
+            return;
+        }
+
+        affinity_changed = true;
+    }
+
+    void apply(const Options& options) {
+        errno = 0;
+        initial_nice = getpriority(PRIO_PROCESS, 0);
+        sched_getaffinity(0, sizeof(initial_cpus), &initial_cpus);
+
+        if(options.realtime_priority)
+            set_realtime(options.realtime_priority);
+        if(options.lock_memory)
+            lock_memory();
+        if(!options.affinity.empty())
+            set_affinity(options.affinity);
+
+        sched_param param;
+        sched_getparam(0, &param);
+        state.policy = sched_getscheduler(0) & ~SCHED_RESET_ON_FORK;
+        state.priority = param.sched_priority;
+        state.nice = getpriority(PRIO_PROCESS, 0);
+
+        cpu_set_t cpus;
+        sched_getaffinity(0, sizeof(cpus), &cpus);
+        state.cpus = CPU_COUNT(&cpus);
+
+        wlr_log(WLR_INFO, "scheduling: %s priority %d, nice %d, memory %slocked, %d cpus",
+                state.policy == SCHED_RR ? "SCHED_RR" : "SCHED_OTHER", state.priority, state.nice,
+                state.memory_locked ? "" : "not ", state.cpus);
+    }
+
+    void reset_child(pid_t pid) {
+        // Children start from the compositor's state, a race with threads they'd start
+        // right away is harmless
+        if(nice_changed)
+            setpriority(PRIO_PROCESS, pid, initial_nice);
+        if(affinity_changed)
+            sched_setaffinity(pid, sizeof(initial_cpus), &initial_cpus);
+    }
+}
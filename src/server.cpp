@@ -5,10 +5,22 @@
 #include <cassert>
 #include <stdexcept>
 
+#include "config/config.hpp"
+#include "focus-boost.hpp"
+#include "frame-pacing.hpp"
 #include "layer-shell.hpp"
 #include "output.hpp"
-
-Server server;
+#include "startup.hpp"
+#include "toplevel-capture.hpp"
+#include "trace.hpp"
+#include "watchdog.hpp"
+#ifdef HAVE_XWAYLAND
+#include "xwayland.hpp"
+#endif
+
+// Only constructed by Server::create
+alignas(Server) unsigned char server_storage[sizeof(Server)];
+Server& server = *reinterpret_cast<Server*>(server_storage);
 
 void backend_destroy(wl_listener* listener, void* data) {
     server.new_output.free();
@@ -25,6 +37,11 @@ void layer_shell_destroy(wl_listener* listener, void* data) {
     server.layer_shell_destroy.free();
 }
 
+void compositor_destroy(wl_listener* listener, void* data) {
+    server.new_surface.free();
+    server.compositor_destroy.free();
+}
+
 Server::Server()
     :  // wl_display global.
        // Needed for the registry and the creation of more objects
@@ -32,7 +49,8 @@ Server::Server()
 
       // Backend. Abstracts input and output hardware.
       // Supports stuff like X11 windows, DRM, libinput, headless, etc.
-      backend(wlr_backend_autocreate(wl_display_get_event_loop(display), &session)),
+      backend(startup::mark("backend",
+                            wlr_backend_autocreate(wl_display_get_event_loop(display), &session))),
 
       // Automatically chooses a wlr renderer. Can be Pixman, GLES2 or Vulkan.
       // Can be overridden by the user with the WLR_RENDERER env var
@@ -40,7 +58,7 @@ Server::Server()
 
       // Creates an allocator. The allocator allocates pixel buffers with
       // the correct capabilities and position based on the backend and renderer
-      allocator(wlr_allocator_autocreate(backend, renderer)),
+      allocator(startup::mark("renderer", wlr_allocator_autocreate(backend, renderer))),
 
       // Root of the scene graph tree
       root(display),
@@ -50,26 +68,49 @@ Server::Server()
       scene_layout(wlr_scene_attach_output_layout(root.scene, server.root.output_layout)),
 
       // Protocols
+      // wl_compositor global, needed for clients to create surfaces
+      compositor(wlr_compositor_create(display, 6, renderer)),
       xdg_shell(wlr_xdg_shell_create(display, 6)),
       layer_shell(wlr_layer_shell_v1_create(display, 5)),
       screencopy_manager_v1(wlr_screencopy_manager_v1_create(display)),
       ext_image_copy_capture_manager_v1(wlr_ext_image_copy_capture_manager_v1_create(display, 1)),
       xdg_output_manager_v1(wlr_xdg_output_manager_v1_create(display, server.root.output_layout)),
       output_manager_v1(wlr_output_manager_v1_create(display)),
+      output_power_manager_v1(wlr_output_power_manager_v1_create(display)),
+      ext_foreign_toplevel_list_v1(wlr_ext_foreign_toplevel_list_v1_create(display, 1)),
+      ext_foreign_toplevel_image_capture_source_manager_v1(
+          wlr_ext_foreign_toplevel_image_capture_source_manager_v1_create(display, 1)),
 
       // Managers for input and output
       input_manager(display, backend),
       output_manager(display),
 
+      // Idle notifications for idle daemons and inhibitors for video players
+      idle(display),
+
+      // Spawns and reaps child processes
+      launcher(display),
+
+      // Serves IPC clients from the event loop
+      ipc(display),
+
+      // Runs blocking work off the event loop
+      workers(display),
+
       // Listeners
       new_output(this, output::new_output, &backend->events.new_output),
       new_xdg_toplevel(this, xdg_shell::new_xdg_toplevel, &xdg_shell->events.new_toplevel),
       new_layer_shell_surface(this, layer_shell::new_surface, &layer_shell->events.new_surface),
+      new_surface(this, clients::new_surface, &compositor->events.new_surface),
+      new_toplevel_capture_request(
+          this, toplevel_capture::new_request,
+          &ext_foreign_toplevel_image_capture_source_manager_v1->events.new_request),
 
       // Cleanup listeners
       backend_destroy(this, ::backend_destroy, &backend->events.destroy),
       xdg_shell_destroy(this, ::xdg_shell_destroy, &xdg_shell->events.destroy),
-      layer_shell_destroy(this, ::layer_shell_destroy, &layer_shell->events.destroy) {
+      layer_shell_destroy(this, ::layer_shell_destroy, &layer_shell->events.destroy),
+      compositor_destroy(this, ::compositor_destroy, &compositor->events.destroy) {
     if(!backend)
         throw std::runtime_error("failed to create wlr_backend");
 
@@ -90,10 +131,6 @@ Server::Server()
     if(!allocator)
         throw std::runtime_error("failed to create wlr_allocator");
 
-    // wl_compositor global.
-    // Needed for clients to create surfaces
-    wlr_compositor_create(display, 6, renderer);
-
     // wl_subcompositor global.
     // Needed for clients to create subsurfaces
     wlr_subcompositor_create(display);
@@ -104,10 +141,30 @@ Server::Server()
     wlr_data_device_manager_create(display);
 
     wlr_viewporter_create(display);
+    // Solid color surfaces as 1x1 buffers scaled with the viewporter, the scene draws them
+    // as rects without a texture and counts opaque ones when culling occluded nodes
+    wlr_single_pixel_buffer_manager_v1_create(display);
+    frame_pacing::init(display);
     wlr_ext_output_image_capture_source_manager_v1_create(display, 1);
+
+    // Tracing of the hot paths, toggled with SIGUSR2
+    trace::init(display);
+
+    startup::mark("globals");
+}
+
+void Server::create() {
+    new(server_storage) Server();
+}
+
+void Server::destroy() {
+    server.~Server();
 }
 
 Server::~Server() {
+#ifdef HAVE_XWAYLAND
+    xwayland::stop();
+#endif
     wl_display_destroy_clients(display);
 
     wlr_scene_node_destroy(&root.scene->tree.node);
@@ -132,16 +189,36 @@ void Server::start(char* startup_cmd) {
 
     if(!wlr_backend_start(backend))
         throw std::runtime_error("couldn't start backend");
+    startup::mark("backend start");
 
     setenv("WAYLAND_DISPLAY", socket.c_str(), true);
+    // Before the startup commands, so they get DWC_SOCK
+    ipc.start();
+
+#ifdef HAVE_XWAYLAND
+    // Also before the startup commands, for DISPLAY
+    if(conf.xwayland != config::XwaylandMode::DISABLED)
+        xwayland::start(display, compositor, conf.xwayland == config::XwaylandMode::LAZY);
+#else
+    if(conf.xwayland == config::XwaylandMode::FORCE)
+        wlr_log(WLR_ERROR, "dwc was built without Xwayland support");
+#endif
+
+    // Clients can connect from now on, they get served once the event loop runs
+    startup::mark("ready");
+    startup::notify_ready(("running on WAYLAND_DISPLAY=" + socket).c_str());
+
     conf.execute_phase(ConfigLoadPhase::COMPOSITOR_START);
 
     wlr_log(WLR_INFO, "Running Wayland compositor on WAYLAND_DISPLAY=%s", socket.c_str());
-    wl_display_run(display);
+    watchdog::run(display);
+    watchdog::log_stats();
+    focus_boost::restore();
 }
 
 template <typename T>
 T* Server::surface_at(double lx, double ly, wlr_surface*& surface, double& sx, double& sy) {
+    metrics::hit_tests.inc();
     wlr_scene_node* node = wlr_scene_node_at(&root.scene->tree.node, lx, ly, &sx, &sy);
     if(!node || node->type != WLR_SCENE_NODE_BUFFER)
         return nullptr;
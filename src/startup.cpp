@@ -0,0 +1,89 @@
+#include "startup.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "util.hpp"
+#include "wlr.hpp"
+
+namespace startup {
+    std::vector<Phase> phases;
+
+    uint64_t start = 0;
+    // End of the last phase
+    uint64_t last = 0;
+    // Set on the first frame
+    bool done = false;
+
+    void begin() {
+        start = last = now_ns();
+    }
+
+    void mark(const char* name) {
+        if(done)
+            return;
+
+        for(const Phase& phase : phases) {
+            if(strcmp(phase.name, name) == 0)
+                return;
+        }
+
+        uint64_t now = now_ns();
+        phases.push_back({ name, now - last });
+        last = now;
+        wlr_log(WLR_INFO, "startup: %s took %.1f ms", name, phases.back().duration_ns / 1e6);
+
+        if(strcmp(name, "first frame") == 0) {
+            done = true;
+            wlr_log(WLR_INFO, "startup: first frame %.1f ms after start", (now - start) / 1e6);
+        }
+    }
+
+    void record(const char* name, uint64_t duration_ns) {
+        phases.push_back({ name, duration_ns });
+        wlr_log(WLR_INFO, "startup: %s took %.1f ms", name, duration_ns / 1e6);
+    }
+
+    void notify_ready(const char* status) {
+        const char* path = getenv("NOTIFY_SOCKET");
+        if(!path)
+            return;
+
+        sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+
+        // Abstract sockets start with @
+        size_t length = strlen(path);
+        if((path[0] != '/' && path[0] != '@') || length < 2 || length >= sizeof(addr.sun_path)) {
+            wlr_log(WLR_ERROR, "invalid NOTIFY_SOCKET '%s'", path);
+            unsetenv("NOTIFY_SOCKET");
+            return;
+        }
+
+        memcpy(addr.sun_path, path, length);
+        if(addr.sun_path[0] == '@')
+            addr.sun_path[0] = '\0';
+
+        std::string message = std::string("READY=1\nSTATUS=") + status;
+
+        int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if(fd < 0 || sendto(fd, message.data(), message.size(), MSG_NOSIGNAL, (sockaddr*)&addr,
+                            offsetof(sockaddr_un, sun_path) + length) < 0)
+            wlr_log(WLR_ERROR, "failed to notify readiness: %s", strerror(errno));
+        else
+            wlr_log(WLR_DEBUG, "notified readiness to %s", path);
+
+        if(fd >= 0)
+            close(fd);
+
+        // Spawned programs would otherwise notify in our name
+        unsetenv("NOTIFY_SOCKET");
+    }
+}
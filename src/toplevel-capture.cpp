@@ -0,0 +1,51 @@
+#include "toplevel-capture.hpp"
+
+#include "server.hpp"
+
+namespace toplevel_capture {
+    void new_request(wl_listener* listener, void* data) {
+        auto* request =
+            static_cast<wlr_ext_foreign_toplevel_image_capture_source_manager_v1_request*>(data);
+        xdg_shell::Toplevel* toplevel =
+            static_cast<xdg_shell::Toplevel*>(request->toplevel_handle->data);
+        if(!toplevel)
+            return;
+
+        if(!toplevel->capture) {
+            toplevel->capture = new Capture(toplevel);
+            if(!toplevel->capture->source) {
+                delete toplevel->capture;
+                toplevel->capture = nullptr;
+                return;
+            }
+        }
+
+        wlr_ext_foreign_toplevel_image_capture_source_manager_v1_request_accept(
+            request, toplevel->capture->source);
+    }
+
+    Capture::Capture(xdg_shell::Toplevel* toplevel)
+        : scene(wlr_scene_create()),
+          source(nullptr) {
+        // The view goes in a tree of ours, which outlives the view when the toplevel's
+        // surface is destroyed, so the source never loses its node
+        wlr_scene_tree* tree = wlr_scene_tree_create(&scene->tree);
+        if(!toplevel->create_view(tree)) {
+            wlr_log(WLR_ERROR, "toplevel %u can't be captured", toplevel->id);
+            return;
+        }
+
+        // Renders the subtree with damage tracking, only when it changes
+        source = wlr_ext_image_capture_source_v1_create_with_scene_node(
+            &tree->node, wl_display_get_event_loop(server.display), server.allocator,
+            server.renderer);
+        if(!source) {
+            wlr_log(WLR_ERROR, "failed to create a capture source for toplevel %u",
+                    toplevel->id);
+        }
+    }
+
+    Capture::~Capture() {
+        wlr_scene_node_destroy(&scene->tree.node);
+    }
+}
@@ -0,0 +1,118 @@
+#include "trace.hpp"
+
+#include <signal.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <vector>
+
+namespace trace {
+    // Power of two, so the ring index is a mask
+    constexpr size_t CAPACITY = 1 << 16;
+
+    struct Event {
+        const char* name;
+        uint64_t start;
+        uint64_t end;
+        pid_t tid;
+    };
+
+    std::atomic<bool> enabled = false;
+
+    // Allocated on the first start, so an untraced session doesn't pay for it
+    std::vector<Event> buffer;
+    // Total events recorded since start(), the ring index is head & (CAPACITY - 1)
+    std::atomic<uint64_t> head = 0;
+    // Threads inside record(), stop() waits for them before reading the buffer
+    std::atomic<uint32_t> writers = 0;
+    // Used to name the trace files
+    int traces = 0;
+
+    pid_t thread_id() {
+        thread_local pid_t tid = syscall(SYS_gettid);
+        return tid;
+    }
+
+    // Called by the event loop when a SIGUSR2 is received
+    int handle_sigusr2(int signal_number, void* data) {
+        if(enabled.load(std::memory_order_relaxed))
+            stop();
+        else
+            start();
+        return 0;
+    }
+
+    void init(wl_display* display) {
+        if(!wl_event_loop_add_signal(wl_display_get_event_loop(display), SIGUSR2,
+                                     trace::handle_sigusr2, nullptr))
+            wlr_log(WLR_ERROR, "failed to add SIGUSR2 source - tracing only available over IPC");
+    }
+
+    void start() {
+        if(enabled.load(std::memory_order_relaxed))
+            return;
+
+        if(buffer.empty())
+            buffer.resize(CAPACITY);
+        head.store(0, std::memory_order_relaxed);
+
+        // Publishes the buffer to the workers that see tracing enabled
+        enabled.store(true, std::memory_order_release);
+        wlr_log(WLR_INFO, "tracing started");
+    }
+
+    std::string stop() {
+        // Sequentially consistent with record(), so a worker either sees tracing stopped or
+        // is counted in writers
+        if(!enabled.exchange(false))
+            return "";
+        // Writers only copy one event, this doesn't spin for long
+        while(writers.load() != 0) {}
+
+        const char* dir = getenv("XDG_RUNTIME_DIR");
+        std::string path = std::string(dir ? dir : "/tmp") + "/dwc-trace-" +
+                           std::to_string(getpid()) + "-" + std::to_string(traces++) + ".json";
+
+        FILE* file = fopen(path.c_str(), "we");
+        if(!file) {
+            wlr_log_errno(WLR_ERROR, "failed opening trace file %s", path.c_str());
+            return "";
+        }
+
+        uint64_t total = head.load(std::memory_order_relaxed);
+        uint64_t first = total > CAPACITY ? total - CAPACITY : 0;
+        pid_t pid = getpid();
+
+        // Chrome trace event format, complete events with microsecond timestamps
+        fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", file);
+        for(uint64_t i = first; i < total; i++) {
+            const Event& event = buffer[i & (CAPACITY - 1)];
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,",
+                    i == first ? "" : ",", event.name, event.start / 1000.0,
+                    (event.end - event.start) / 1000.0);
+            fprintf(file, "\"pid\":%d,\"tid\":%d}\n", pid, event.tid);
+        }
+        fputs("]}\n", file);
+
+        bool ok = !ferror(file);
+        if(fclose(file) != 0 || !ok) {
+            wlr_log(WLR_ERROR, "failed writing trace file %s", path.c_str());
+            return "";
+        }
+
+        wlr_log(WLR_INFO, "tracing stopped, wrote %lu events (%lu dropped) to %s",
+                (unsigned long)(total - first), (unsigned long)first, path.c_str());
+        return path;
+    }
+
+    void record(const char* name, uint64_t start, uint64_t end) {
+        writers.fetch_add(1);
+        // The scope may have started right before tracing was stopped
+        if(enabled.load()) {
+            uint64_t index = head.fetch_add(1, std::memory_order_relaxed);
+            buffer[index & (CAPACITY - 1)] = { name, start, end, thread_id() };
+        }
+        writers.fetch_sub(1, std::memory_order_release);
+    }
+}
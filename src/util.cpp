@@ -1,5 +1,7 @@
 #include "util.hpp"
 
+#include <time.h>
+
 #include <algorithm>
 #include <format>
 
@@ -42,3 +44,9 @@ std::string device_identifier(wlr_input_device *device) {
 
     return std::format("{}:{}:{}", vendor, product, name);
 }
+
+uint64_t now_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
@@ -0,0 +1,122 @@
+#include "watchdog.hpp"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <poll.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <vector>
+
+#include "config/config.hpp"
+
+namespace watchdog {
+    LoopStats loop_stats = { 0, 0, 0, 0 };
+    std::unordered_map<Callback*, HandlerStats> handler_stats;
+
+    bool running = false;
+    // Whether a handler already went over the budget in the current iteration
+    bool handler_stalled = false;
+
+    void run(wl_display* display) {
+        wl_event_loop* loop = wl_display_get_event_loop(display);
+        pollfd loop_fd = { wl_event_loop_get_fd(loop), POLLIN, 0 };
+
+        running = true;
+        while(running) {
+            // Idle sources added outside of a dispatch would otherwise wait for the next event
+            wl_event_loop_dispatch_idle(loop);
+            wl_display_flush_clients(display);
+
+            // Waiting isn't part of the iteration, so it's done separately
+            if(poll(&loop_fd, 1, -1) < 0 && errno != EINTR) {
+                wlr_log_errno(WLR_ERROR, "failed polling the event loop");
+                break;
+            }
+
+            uint64_t start = now_ns();
+            handler_stalled = false;
+            wl_event_loop_dispatch(loop, 0);
+            wl_display_flush_clients(display);
+            uint64_t duration = now_ns() - start;
+
+            loop_stats.iterations++;
+            loop_stats.total += duration;
+            loop_stats.max = std::max(loop_stats.max, duration);
+
+            if(duration > conf.watchdog_budget) {
+                loop_stats.stalls++;
+                // Already logged with the handler responsible for it
+                if(!handler_stalled)
+                    wlr_log(WLR_INFO, "event loop iteration took %.2f ms outside of handlers",
+                            duration / 1e6);
+            }
+        }
+    }
+
+    void terminate(wl_display* display) {
+        running = false;
+        // Wakes up the loop
+        wl_display_terminate(display);
+    }
+
+    void record(Callback* callback, uint64_t start, uint64_t end) {
+        uint64_t duration = end - start;
+
+        HandlerStats& stats = handler_stats[callback];
+        stats.calls++;
+        stats.total += duration;
+        stats.max = std::max(stats.max, duration);
+
+        if(duration > conf.watchdog_budget) {
+            stats.stalls++;
+            handler_stalled = true;
+            wlr_log(WLR_INFO, "handler %s took %.2f ms (budget %.2f ms)",
+                    handler_name(callback).c_str(), duration / 1e6, conf.watchdog_budget / 1e6);
+        }
+    }
+
+    std::string handler_name(Callback* callback) {
+        Dl_info info;
+        if(!dladdr(reinterpret_cast<void*>(callback), &info) || !info.dli_fbase)
+            return "unknown";
+
+        // Needs the symbols to be exported, which the build does with export_dynamic
+        if(info.dli_sname) {
+            int status;
+            char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            std::string name = status == 0 ? demangled : info.dli_sname;
+            free(demangled);
+            return name;
+        }
+
+        // Can be resolved with addr2line
+        char offset[32];
+        snprintf(offset, sizeof(offset), "+0x%lx",
+                 (unsigned long)(reinterpret_cast<uintptr_t>(callback) -
+                                 reinterpret_cast<uintptr_t>(info.dli_fbase)));
+        return std::string(info.dli_fname ? info.dli_fname : "") + offset;
+    }
+
+    void log_stats() {
+        wlr_log(WLR_INFO,
+                "event loop: %lu iterations, %.2f ms average, %.2f ms max, %lu over budget",
+                (unsigned long)loop_stats.iterations,
+                loop_stats.iterations ? loop_stats.total / 1e6 / loop_stats.iterations : 0.0,
+                loop_stats.max / 1e6, (unsigned long)loop_stats.stalls);
+
+        std::vector<std::pair<Callback*, HandlerStats>> sorted(handler_stats.begin(),
+                                                               handler_stats.end());
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const auto& a, const auto& b) { return a.second.total > b.second.total; });
+
+        // The ones that took the most time overall
+        for(size_t i = 0; i < sorted.size() && i < 10; i++) {
+            const HandlerStats& stats = sorted[i].second;
+            wlr_log(WLR_INFO, "  %s: %lu calls, %.2f ms total, %.2f ms max, %lu over budget",
+                    handler_name(sorted[i].first).c_str(), (unsigned long)stats.calls,
+                    stats.total / 1e6, stats.max / 1e6, (unsigned long)stats.stalls);
+        }
+    }
+}
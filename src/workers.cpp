@@ -0,0 +1,129 @@
+#include "workers.hpp"
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+namespace workers {
+    constexpr unsigned MAX_THREADS = 2;
+
+    // Called by the event loop when workers finished some jobs
+    int handle_completion(int fd, uint32_t mask, void* data) {
+        WorkerPool* pool = static_cast<WorkerPool*>(data);
+
+        uint64_t count;
+        if(read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+            wlr_log_errno(WLR_ERROR, "failed reading worker eventfd");
+
+        std::deque<std::function<void()>> completed;
+        {
+            std::lock_guard<std::mutex> lock(pool->mutex);
+            completed.swap(pool->completed);
+        }
+
+        for(auto& done : completed) done();
+        return 0;
+    }
+
+    WorkerPool::WorkerPool(wl_display* display)
+        : loop(wl_display_get_event_loop(display)),
+          event_fd(-1),
+          source(nullptr),
+          stopping(false) {}
+
+    WorkerPool::~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cond.notify_all();
+
+        // Jobs that didn't run yet are dropped
+        for(auto& thread : threads) thread.join();
+
+        // The event loop and its sources are already gone with the display
+        if(event_fd >= 0)
+            close(event_fd);
+    }
+
+    void WorkerPool::submit(std::function<void()> work, std::function<void()> done) {
+        if(threads.empty() && !start_threads()) {
+            // Still better than not doing the work at all
+            work();
+            done();
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back({ std::move(work), std::move(done) });
+        }
+        cond.notify_one();
+    }
+
+    bool WorkerPool::start_threads() {
+        event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if(event_fd < 0) {
+            wlr_log_errno(WLR_ERROR, "failed to create worker eventfd");
+            return false;
+        }
+
+        source = wl_event_loop_add_fd(loop, event_fd, WL_EVENT_READABLE,
+                                      workers::handle_completion, this);
+        if(!source) {
+            wlr_log(WLR_ERROR, "failed to add worker eventfd to the event loop");
+            close(event_fd);
+            event_fd = -1;
+            return false;
+        }
+
+        unsigned count = std::clamp(std::thread::hardware_concurrency(), 1u, MAX_THREADS);
+
+        // Signals are handled by the event loop through signalfds, workers must never
+        // get them. Threads inherit the mask, so blocking everything here leaves no
+        // window where a worker could take one
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, &old);
+
+        for(unsigned i = 0; i < count; i++) {
+            threads.emplace_back(&WorkerPool::run, this);
+            pthread_setname_np(threads.back().native_handle(), "dwc-worker");
+        }
+
+        pthread_sigmask(SIG_SETMASK, &old, nullptr);
+        return true;
+    }
+
+    void WorkerPool::run() {
+        while(1) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [this] { return stopping || !pending.empty(); });
+                if(stopping)
+                    return;
+
+                job = std::move(pending.front());
+                pending.pop_front();
+            }
+
+            job.work();
+            // Whatever the job captured is released by done, on the main thread
+            job.work = nullptr;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                completed.push_back(std::move(job.done));
+            }
+
+            uint64_t one = 1;
+            if(write(event_fd, &one, sizeof(one)) < 0)
+                wlr_log_errno(WLR_ERROR, "failed signalling worker completion");
+        }
+    }
+}
@@ -80,6 +80,10 @@ namespace workspace {
 
         active = true;
         output->active_workspace = this;
+
+        // Switches and fullscreen changes both end up here
+        server.idle.update_inhibited();
+        server.ipc.notify(ipc::SUBSCRIBE_WORKSPACE | ipc::SUBSCRIBE_FOCUS);
     }
 
     Workspace* focus_or_create(int id) {
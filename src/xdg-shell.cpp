@@ -3,86 +3,53 @@
 #include <algorithm>
 #include <cassert>
 
+#include "metrics.hpp"
 #include "server.hpp"
+#include "toplevel-capture.hpp"
+#include "trace.hpp"
 
 namespace xdg_shell {
+    // Source of toplevel ids, 0 is never used so it can mean no toplevel
+    uint32_t next_id = 1;
+    // Toplevels whose title or app_id changed since the last frame
+    std::list<Toplevel*> dirty_toplevels;
+
     void new_xdg_toplevel(wl_listener* listener, void* data) {
         wlr_xdg_toplevel* xdg_toplevel = static_cast<wlr_xdg_toplevel*>(data);
 
-        new Toplevel(xdg_toplevel);
+        new XdgToplevel(xdg_toplevel);
     }
 
     // Called when a surface gets mapped
     void xdg_toplevel_map(wl_listener* listener, void* data) {
-        Toplevel* toplevel = static_cast<wrapper::Listener<Toplevel>*>(listener)->container;
-
-        output::Output* output = server.output_manager.focused_output();
-        if(!output && !server.output_manager.outputs.empty())
-            output = server.output_manager.outputs.front();
-
-        if(output) {
-            assert(output->active_workspace);
-
-            toplevel->workspace = output->active_workspace;
-            toplevel->workspace->floating.push_back(toplevel);
-
-            wlr_surface_set_preferred_buffer_scale(toplevel->toplevel->base->surface,
-                                                   output->output->scale);
-
-            wlr_box* usable_area = &output->usable_area;
+        XdgToplevel* toplevel = static_cast<wrapper::Listener<XdgToplevel>*>(listener)->container;
 
-            uint32_t width = toplevel->toplevel->scheduled.width > 0
-                                 ? toplevel->toplevel->scheduled.width
-                                 : toplevel->toplevel->current.width;
+        uint32_t width = toplevel->toplevel->scheduled.width > 0
+                             ? toplevel->toplevel->scheduled.width
+                             : toplevel->toplevel->current.width;
 
-            uint32_t height = toplevel->toplevel->scheduled.height > 0
-                                  ? toplevel->toplevel->scheduled.height
-                                  : toplevel->toplevel->current.height;
-
-            if(!width || !height) {
-                width = toplevel->toplevel->base->surface->current.width;
-                height = toplevel->toplevel->base->surface->current.height;
-            }
-
-            width = std::min(width, (uint32_t)usable_area->width);
-            height = std::min(height, (uint32_t)usable_area->height);
-
-            int x = output->output_box.x + (usable_area->width - width) / 2;
-            int y = output->output_box.y + (usable_area->height - height) / 2;
-
-            x = std::max(x, usable_area->x);
-            y = std::max(y, usable_area->y);
+        uint32_t height = toplevel->toplevel->scheduled.height > 0
+                              ? toplevel->toplevel->scheduled.height
+                              : toplevel->toplevel->current.height;
 
-            wlr_scene_node_set_position(&toplevel->scene_tree->node, x, y);
+        if(!width || !height) {
+            width = toplevel->toplevel->base->surface->current.width;
+            height = toplevel->toplevel->base->surface->current.height;
         }
 
-        server.toplevels.push_back(toplevel);
-        wl_signal_emit(&server.root.events.new_node, static_cast<void*>(&toplevel->node));
+        toplevel->handle_map(width, height);
     }
 
     // Called when an xdg_toplevel gets unmapped
     void xdg_toplevel_unmap(wl_listener* listener, void* data) {
-        Toplevel* toplevel = static_cast<wrapper::Listener<Toplevel>*>(listener)->container;
-
-        // Reset cursor mode if the toplevel was currently grabbed
-        if(toplevel == server.input_manager.seat.cursor.grabbed_toplevel)
-            server.input_manager.seat.cursor.reset_cursor_mode();
-
-        for(auto& ws : server.root.workspaces) {
-            if(ws.second->focused_toplevel == toplevel)
-                ws.second->focused_toplevel = nullptr;
-        }
-
-        wl_signal_emit(&toplevel->node.events.node_destroy, static_cast<void*>(&toplevel->node));
-        server.toplevels.remove(toplevel);
-        toplevel->workspace->floating.remove(toplevel);
-        if(toplevel->workspace->focused_toplevel == toplevel)
-            toplevel->workspace->focused_toplevel = nullptr;
+        XdgToplevel* toplevel = static_cast<wrapper::Listener<XdgToplevel>*>(listener)->container;
+        toplevel->handle_unmap();
     }
 
     // Called when a commit gets applied to a toplevel
     void xdg_toplevel_commit(wl_listener* listener, void* data) {
-        Toplevel* toplevel = static_cast<wrapper::Listener<Toplevel>*>(listener)->container;
+        TRACE_SCOPE("xdg_shell::toplevel_commit");
+        XdgToplevel* toplevel = static_cast<wrapper::Listener<XdgToplevel>*>(listener)->container;
 
         if(toplevel->toplevel->base->initial_commit)
             // Set size to 0,0 so the client can choose the size
@@ -91,19 +58,20 @@ namespace xdg_shell {
 
     // Called when an xdg_toplevel gets destroyed
     void xdg_toplevel_destroy(wl_listener* listener, void* data) {
-        Toplevel* toplevel = static_cast<wrapper::Listener<Toplevel>*>(listener)->container;
+        XdgToplevel* toplevel = static_cast<wrapper::Listener<XdgToplevel>*>(listener)->container;
+        metrics::toplevels_destroyed.inc();
         delete toplevel;
     }
 
     // Called when an xdg_toplevel requests a move
     void xdg_toplevel_request_move(wl_listener* listener, void* data) {
-        Toplevel* toplevel = static_cast<wrapper::Listener<Toplevel>*>(listener)->container;
+        XdgToplevel* toplevel = static_cast<wrapper::Listener<XdgToplevel>*>(listener)->container;
         server.input_manager.seat.cursor.begin_interactive(toplevel, cursor::CursorMode::MOVE, 0);
     }
 
     // Called when an xdg_toplevel requests a resize
     void xdg_toplevel_request_resize(wl_listener* listener, void* data) {
-        Toplevel* toplevel = static_cast<wrapper::Listener<Toplevel>*>(listener)->container;
+        XdgToplevel* toplevel = static_cast<wrapper::Listener<XdgToplevel>*>(listener)->container;
         wlr_xdg_toplevel_resize_event* event = static_cast<wlr_xdg_toplevel_resize_event*>(data);
         server.input_manager.seat.cursor.begin_interactive(toplevel, cursor::CursorMode::RESIZE,
                                                            event->edges);
@@ -111,29 +79,56 @@ namespace xdg_shell {
 
     // Called when an xdg_toplevel requests to be maximized
     void xdg_toplevel_request_maximize(wl_listener* listener, void* data) {
-        Toplevel* toplevel = static_cast<wrapper::Listener<Toplevel>*>(listener)->container;
+        XdgToplevel* toplevel = static_cast<wrapper::Listener<XdgToplevel>*>(listener)->container;
         toplevel->fullscreen();
     }
 
     // Called when an xdg_toplevel requests to be minimized
     void xdg_toplevel_request_minimize(wl_listener* listener, void* data) {
-        Toplevel* toplevel = static_cast<wrapper::Listener<Toplevel>*>(listener)->container;
+        XdgToplevel* toplevel = static_cast<wrapper::Listener<XdgToplevel>*>(listener)->container;
         if(toplevel->toplevel->base->initialized)
             wlr_xdg_surface_schedule_configure(toplevel->toplevel->base);
     }
 
     // Called when an xdg_toplevel requests fullscreen
     void xdg_toplevel_request_fullscreen(wl_listener* listener, void* data) {
-        Toplevel* toplevel = static_cast<wrapper::Listener<Toplevel>*>(listener)->container;
+        XdgToplevel* toplevel = static_cast<wrapper::Listener<XdgToplevel>*>(listener)->container;
         toplevel->fullscreen();
     }
 
+    // Called when an xdg_toplevel changes its title
+    void xdg_toplevel_set_title(wl_listener* listener, void* data) {
+        XdgToplevel* toplevel = static_cast<wrapper::Listener<XdgToplevel>*>(listener)->container;
+        toplevel->handle_title_change();
+    }
+
+    // Called when an xdg_toplevel changes its app_id
+    void xdg_toplevel_set_app_id(wl_listener* listener, void* data) {
+        XdgToplevel* toplevel = static_cast<wrapper::Listener<XdgToplevel>*>(listener)->container;
+        toplevel->handle_app_id_change();
+    }
+
+    void flush_foreign_toplevels() {
+        if(dirty_toplevels.empty())
+            return;
+
+        TRACE_SCOPE("xdg_shell::flush_foreign_toplevels");
+        for(Toplevel* toplevel : dirty_toplevels) {
+            toplevel->foreign_dirty = false;
+
+            wlr_ext_foreign_toplevel_handle_v1_state state = { .title = toplevel->title(),
+                                                               .app_id = toplevel->app_id() };
+            wlr_ext_foreign_toplevel_handle_v1_update_state(toplevel->foreign_handle, &state);
+        }
+        dirty_toplevels.clear();
+    }
+
     // Called when a popup is created by a client
     void xdg_toplevel_new_popup(wl_listener* listener, void* data) {
-        Toplevel* toplevel = static_cast<wrapper::Listener<Toplevel>*>(listener)->container;
+        XdgToplevel* toplevel = static_cast<wrapper::Listener<XdgToplevel>*>(listener)->container;
         wlr_xdg_popup* xdg_popup = static_cast<wlr_xdg_popup*>(data);
 
-        new Popup(xdg_popup, toplevel->scene_tree);
+        new Popup(xdg_popup, toplevel->scene_tree, toplevel->popups, toplevel->views);
     }
 
     void xdg_popup_commit(wl_listener* listener, void* data) {
@@ -162,37 +157,57 @@ namespace xdg_shell {
     }
 
     void xdg_popup_destroy(wl_listener* listener, void* data) {
-        delete static_cast<wrapper::Listener<Popup>*>(listener)->container;
+        Popup* popup = static_cast<wrapper::Listener<Popup>*>(listener)->container;
+        metrics::popups_destroyed.inc();
+        if(popup->siblings)
+            popup->siblings->remove(popup);
+        delete popup;
+    }
+
+    // Called when a configure is sent to a toplevel or a popup
+    void xdg_surface_configure(wl_listener* listener, void* data) {
+        metrics::xdg_configures.inc();
     }
 
     void xdg_popup_new_popup(wl_listener* listener, void* data) {
         Popup* popup = static_cast<wrapper::Listener<Popup>*>(listener)->container;
         wlr_xdg_popup* xdg_popup = static_cast<wlr_xdg_popup*>(data);
 
-        new Popup(xdg_popup, popup->scene);
+        new Popup(xdg_popup, popup->scene, popup->popups, popup->views);
     }
 
-    Toplevel::Toplevel(wlr_xdg_toplevel* xdg_toplevel)
-        : toplevel(xdg_toplevel),
-          node(this),
-          scene_tree(wlr_scene_xdg_surface_create(server.root.floating, toplevel->base)),
-          workspace(nullptr),
-
-          map(this, xdg_toplevel_map, &toplevel->base->surface->events.map),
-          unmap(this, xdg_toplevel_unmap, &toplevel->base->surface->events.unmap),
-          commit(this, xdg_toplevel_commit, &toplevel->base->surface->events.commit),
-          destroy(this, xdg_toplevel_destroy, &toplevel->events.destroy),
+    void view_destroy(wl_listener* listener, void* data) {
+        View* view = static_cast<wrapper::Listener<View>*>(listener)->container;
+        view->views.remove(view);
+        delete view;
+    }
 
-          request_move(this, xdg_toplevel_request_move, &toplevel->events.request_move),
-          request_resize(this, xdg_toplevel_request_resize, &toplevel->events.request_resize),
-          request_maximize(this, xdg_toplevel_request_maximize, &toplevel->events.request_maximize),
-          request_minimize(this, xdg_toplevel_request_minimize, &toplevel->events.request_minimize),
-          request_fullscreen(this, xdg_toplevel_request_fullscreen,
-                             &toplevel->events.request_fullscreen),
+    View::View(wlr_scene_tree* tree, std::list<View*>& views)
+        : tree(tree),
+          views(views),
+          destroy(this, view_destroy, &tree->node.events.destroy) {
+        views.push_back(this);
+    }
 
-          new_popup(this, xdg_toplevel_new_popup, &toplevel->base->events.new_popup) {
-        toplevel->base->data = scene_tree;
+    Toplevel::Toplevel(wlr_scene_tree* scene_tree)
+        : node(this),
+          scene_tree(scene_tree),
+          workspace(nullptr),
+          id(next_id++),
+          foreign_handle(nullptr),
+          capture(nullptr),
+          foreign_dirty(false) {
         scene_tree->node.data = this;
+        metrics::toplevels_created.inc();
+    }
+
+    // Destroying the capture's scene also destroys its source and the clients' objects of it
+    Toplevel::~Toplevel() {
+        delete capture;
+    }
+
+    void Toplevel::set_position(int x, int y) {
+        wlr_scene_node_set_position(&scene_tree->node, x, y);
     }
 
     output::Output* Toplevel::output() {
@@ -202,11 +217,11 @@ namespace xdg_shell {
     void Toplevel::fullscreen() {
         // Unfullscreen
         if(workspace->focused_toplevel == this && workspace->fullscreen) {
-            wlr_xdg_toplevel_set_size(toplevel, saved_geometry.width, saved_geometry.height);
+            set_size(saved_geometry.width, saved_geometry.height);
             wlr_scene_node_reparent(&scene_tree->node, server.root.floating);
-            wlr_xdg_toplevel_set_fullscreen(toplevel, false);
+            set_fullscreen(false);
 
-            wlr_scene_node_set_position(&scene_tree->node, saved_geometry.x, saved_geometry.y);
+            set_position(saved_geometry.x, saved_geometry.y);
 
             workspace->focused_toplevel = this;
             workspace->fullscreen = false;
@@ -217,39 +232,229 @@ namespace xdg_shell {
             if(workspace->focused_toplevel && workspace->fullscreen)
                 workspace->focused_toplevel->fullscreen();
 
-            saved_geometry = toplevel->base->geometry;
+            saved_geometry = geometry();
             saved_geometry.x = scene_tree->node.x;
             saved_geometry.y = scene_tree->node.y;
 
             update_fullscreen();
         }
 
-        wlr_xdg_surface_schedule_configure(toplevel->base);
         workspace->focus();
         server.root.arrange();
     }
 
     void Toplevel::update_fullscreen() {
         output::Output* output = workspace->output;
-        wlr_scene_node_set_position(&scene_tree->node, output->output_box.x, output->output_box.y);
-        wlr_xdg_toplevel_set_size(toplevel, output->output_box.width, output->output_box.height);
+        set_position(output->output_box.x, output->output_box.y);
+        set_size(output->output_box.width, output->output_box.height);
 
         wlr_scene_node_raise_to_top(&scene_tree->node);
         wlr_scene_node_reparent(&scene_tree->node, server.root.fullscreen);
-        wlr_xdg_toplevel_set_fullscreen(toplevel, true);
+        set_fullscreen(true);
 
         workspace->focused_toplevel = this;
         workspace->fullscreen = true;
     }
 
-    Popup::Popup(wlr_xdg_popup* xdg_popup, wlr_scene_tree* parent_tree)
+    void Toplevel::handle_map(uint32_t width, uint32_t height) {
+        // Mirrors have no workspaces
+        output::Output* output = server.output_manager.focused_output();
+        if(!output)
+            output = server.output_manager.fallback_output();
+
+        if(output) {
+            assert(output->active_workspace);
+
+            workspace = output->active_workspace;
+            workspace->floating.push_back(this);
+
+            wlr_surface_set_preferred_buffer_scale(surface(), output->output->scale);
+
+            wlr_box* usable_area = &output->usable_area;
+
+            width = std::min(width, (uint32_t)usable_area->width);
+            height = std::min(height, (uint32_t)usable_area->height);
+
+            int x = output->output_box.x + (usable_area->width - width) / 2;
+            int y = output->output_box.y + (usable_area->height - height) / 2;
+
+            x = std::max(x, usable_area->x);
+            y = std::max(y, usable_area->y);
+
+            set_position(x, y);
+        }
+
+        server.toplevels.push_back(this);
+        wl_signal_emit(&server.root.events.new_node, static_cast<void*>(&node));
+
+        wlr_ext_foreign_toplevel_handle_v1_state state = { .title = title(), .app_id = app_id() };
+        foreign_handle =
+            wlr_ext_foreign_toplevel_handle_v1_create(server.ext_foreign_toplevel_list_v1, &state);
+        if(foreign_handle)
+            foreign_handle->data = this;
+
+        server.idle.update_inhibited();
+        server.ipc.notify(ipc::SUBSCRIBE_WORKSPACE);
+    }
+
+    void Toplevel::handle_unmap() {
+        // Reset cursor mode if the toplevel was currently grabbed
+        if(this == server.input_manager.seat.cursor.grabbed_toplevel)
+            server.input_manager.seat.cursor.reset_cursor_mode();
+
+        for(auto& ws : server.root.workspaces) {
+            if(ws.second->focused_toplevel == this)
+                ws.second->focused_toplevel = nullptr;
+        }
+
+        wl_signal_emit(&node.events.node_destroy, static_cast<void*>(&node));
+        server.toplevels.remove(this);
+        workspace->floating.remove(this);
+        if(workspace->focused_toplevel == this)
+            workspace->focused_toplevel = nullptr;
+
+        if(foreign_dirty) {
+            dirty_toplevels.remove(this);
+            foreign_dirty = false;
+        }
+        if(foreign_handle) {
+            wlr_ext_foreign_toplevel_handle_v1_destroy(foreign_handle);
+            foreign_handle = nullptr;
+        }
+
+        server.idle.update_inhibited();
+        server.ipc.notify(ipc::SUBSCRIBE_WORKSPACE);
+    }
+
+    void Toplevel::handle_title_change() {
+        // The title is only part of the focus state
+        seat::SeatNode* focused = server.input_manager.seat.focused_node;
+        if(focused && focused->node == &node)
+            server.ipc.notify(ipc::SUBSCRIBE_FOCUS);
+
+        queue_foreign_update();
+    }
+
+    void Toplevel::handle_app_id_change() {
+        queue_foreign_update();
+    }
+
+    void Toplevel::queue_foreign_update() {
+        if(!foreign_handle || foreign_dirty)
+            return;
+
+        // Clients like terminals can change their title on every frame, so changes are
+        // coalesced and sent with the next frame, which gets scheduled in case nothing
+        // else is being drawn
+        foreign_dirty = true;
+        dirty_toplevels.push_back(this);
+        if(workspace && workspace->output)
+            wlr_output_schedule_frame(workspace->output->output);
+        else
+            flush_foreign_toplevels();
+    }
+
+    XdgToplevel::XdgToplevel(wlr_xdg_toplevel* xdg_toplevel)
+        : Toplevel(wlr_scene_xdg_surface_create(server.root.floating, xdg_toplevel->base)),
+          toplevel(xdg_toplevel),
+
+          map(this, xdg_toplevel_map, &toplevel->base->surface->events.map),
+          unmap(this, xdg_toplevel_unmap, &toplevel->base->surface->events.unmap),
+          commit(this, xdg_toplevel_commit, &toplevel->base->surface->events.commit),
+          destroy(this, xdg_toplevel_destroy, &toplevel->events.destroy),
+
+          request_move(this, xdg_toplevel_request_move, &toplevel->events.request_move),
+          request_resize(this, xdg_toplevel_request_resize, &toplevel->events.request_resize),
+          request_maximize(this, xdg_toplevel_request_maximize, &toplevel->events.request_maximize),
+          request_minimize(this, xdg_toplevel_request_minimize, &toplevel->events.request_minimize),
+          request_fullscreen(this, xdg_toplevel_request_fullscreen,
+                             &toplevel->events.request_fullscreen),
+          set_title(this, xdg_toplevel_set_title, &toplevel->events.set_title),
+          set_app_id(this, xdg_toplevel_set_app_id, &toplevel->events.set_app_id),
+          configure(this, xdg_surface_configure, &toplevel->base->events.configure),
+
+          new_popup(this, xdg_toplevel_new_popup, &toplevel->base->events.new_popup) {
+        toplevel->base->data = scene_tree;
+    }
+
+    // The views outlive the toplevel, wlroots destroys the trees of the xdg surface after it
+    XdgToplevel::~XdgToplevel() {
+        for(View* view : views) delete view;
+        for(Popup* popup : popups) popup->siblings = nullptr;
+    }
+
+    wlr_surface* XdgToplevel::surface() {
+        return toplevel->base->surface;
+    }
+
+    wlr_box XdgToplevel::geometry() {
+        return toplevel->base->geometry;
+    }
+
+    const char* XdgToplevel::app_id() {
+        return toplevel->app_id;
+    }
+
+    const char* XdgToplevel::title() {
+        return toplevel->title;
+    }
+
+    void XdgToplevel::set_size(int width, int height) {
+        wlr_xdg_toplevel_set_size(toplevel, width, height);
+    }
+
+    void XdgToplevel::set_activated(bool activated) {
+        wlr_xdg_toplevel_set_activated(toplevel, activated);
+    }
+
+    void XdgToplevel::set_fullscreen(bool fullscreen) {
+        wlr_xdg_toplevel_set_fullscreen(toplevel, fullscreen);
+    }
+
+    void XdgToplevel::close() {
+        wlr_xdg_toplevel_send_close(toplevel);
+    }
+
+    wlr_scene_tree* XdgToplevel::create_view(wlr_scene_tree* parent) {
+        // Only the surface and its subsurfaces, popups are separate scene nodes in dwc
+        wlr_scene_tree* tree = wlr_scene_xdg_surface_create(parent, toplevel->base);
+        if(!tree)
+            return nullptr;
+
+        new View(tree, views);
+        for(Popup* popup : popups) popup->create_view(tree);
+        return tree;
+    }
+
+    Popup::Popup(wlr_xdg_popup* xdg_popup, wlr_scene_tree* parent_tree,
+                 std::list<Popup*>& siblings, const std::list<View*>& parent_views)
         : popup(xdg_popup),
 
           scene(wlr_scene_xdg_surface_create(parent_tree, popup->base)),
+          siblings(&siblings),
 
           commit(this, xdg_popup_commit, &popup->base->surface->events.commit),
           destroy(this, xdg_popup_destroy, &popup->events.destroy),
+          configure(this, xdg_surface_configure, &popup->base->events.configure),
           new_popup(this, xdg_popup_new_popup, &popup->base->events.new_popup) {
         xdg_popup->base->data = scene;
+        siblings.push_back(this);
+        for(View* view : parent_views) create_view(view->tree);
+        metrics::popups_created.inc();
+    }
+
+    Popup::~Popup() {
+        for(View* view : views) delete view;
+        for(Popup* child : popups) child->siblings = nullptr;
+    }
+
+    void Popup::create_view(wlr_scene_tree* parent) {
+        // Positioned by wlroots like the popup itself, relative to the parent's surface
+        wlr_scene_tree* tree = wlr_scene_xdg_surface_create(parent, popup->base);
+        if(!tree)
+            return;
+
+        new View(tree, views);
+        for(Popup* child : popups) child->create_view(tree);
     }
 }
@@ -0,0 +1,319 @@
+#include "xwayland.hpp"
+
+#include <cstdlib>
+
+#include "metrics.hpp"
+#include "server.hpp"
+
+namespace xwayland {
+    Xwayland* instance = nullptr;
+
+    bool mapped(wlr_xwayland_surface* xsurface) {
+        return xsurface->surface && xsurface->surface->mapped;
+    }
+
+    void ready(wl_listener* listener, void* data) {
+        Xwayland* xwayland = static_cast<wrapper::Listener<Xwayland>*>(listener)->container;
+        wlr_log(WLR_INFO, "Xwayland is ready on DISPLAY=%s", xwayland->xwayland->display_name);
+    }
+
+    void new_surface(wl_listener* listener, void* data) {
+        wlr_xwayland_surface* xsurface = static_cast<wlr_xwayland_surface*>(data);
+
+        if(xsurface->override_redirect)
+            new Unmanaged(xsurface);
+        else
+            new XwaylandToplevel(xsurface);
+    }
+
+    void toplevel_map(wl_listener* listener, void* data) {
+        XwaylandToplevel* toplevel =
+            static_cast<wrapper::Listener<XwaylandToplevel>*>(listener)->container;
+
+        toplevel->surface_tree =
+            wlr_scene_subsurface_tree_create(toplevel->scene_tree, toplevel->xsurface->surface);
+        toplevel->handle_map(toplevel->xsurface->width, toplevel->xsurface->height);
+    }
+
+    void toplevel_unmap(wl_listener* listener, void* data) {
+        XwaylandToplevel* toplevel =
+            static_cast<wrapper::Listener<XwaylandToplevel>*>(listener)->container;
+
+        toplevel->handle_unmap();
+        wlr_scene_node_destroy(&toplevel->surface_tree->node);
+        toplevel->surface_tree = nullptr;
+    }
+
+    // Called when the X11 window gets a wlr_surface
+    void toplevel_associate(wl_listener* listener, void* data) {
+        XwaylandToplevel* toplevel =
+            static_cast<wrapper::Listener<XwaylandToplevel>*>(listener)->container;
+
+        toplevel->map.emplace(toplevel, toplevel_map, &toplevel->xsurface->surface->events.map);
+        toplevel->unmap.emplace(toplevel, toplevel_unmap,
+                                &toplevel->xsurface->surface->events.unmap);
+    }
+
+    void toplevel_dissociate(wl_listener* listener, void* data) {
+        XwaylandToplevel* toplevel =
+            static_cast<wrapper::Listener<XwaylandToplevel>*>(listener)->container;
+
+        toplevel->map.reset();
+        toplevel->unmap.reset();
+    }
+
+    void toplevel_destroy(wl_listener* listener, void* data) {
+        XwaylandToplevel* toplevel =
+            static_cast<wrapper::Listener<XwaylandToplevel>*>(listener)->container;
+        metrics::toplevels_destroyed.inc();
+        delete toplevel;
+    }
+
+    void toplevel_request_configure(wl_listener* listener, void* data) {
+        XwaylandToplevel* toplevel =
+            static_cast<wrapper::Listener<XwaylandToplevel>*>(listener)->container;
+        wlr_xwayland_surface_configure_event* event =
+            static_cast<wlr_xwayland_surface_configure_event*>(data);
+
+        // The initial geometry is up to the client, afterwards only the size is
+        if(!mapped(toplevel->xsurface)) {
+            wlr_xwayland_surface_configure(toplevel->xsurface, event->x, event->y, event->width,
+                                           event->height);
+            return;
+        }
+
+        toplevel->set_size(event->width, event->height);
+    }
+
+    void toplevel_request_activate(wl_listener* listener, void* data) {
+        XwaylandToplevel* toplevel =
+            static_cast<wrapper::Listener<XwaylandToplevel>*>(listener)->container;
+        if(mapped(toplevel->xsurface))
+            server.input_manager.seat.focus_node(&toplevel->node);
+    }
+
+    void toplevel_request_fullscreen(wl_listener* listener, void* data) {
+        XwaylandToplevel* toplevel =
+            static_cast<wrapper::Listener<XwaylandToplevel>*>(listener)->container;
+        workspace::Workspace* ws = toplevel->workspace;
+        if(!mapped(toplevel->xsurface) || !ws)
+            return;
+
+        // fullscreen() toggles, the X11 request is the wanted state
+        bool fullscreen = ws->fullscreen && ws->focused_toplevel == toplevel;
+        if(toplevel->xsurface->fullscreen != fullscreen)
+            toplevel->fullscreen();
+    }
+
+    void toplevel_request_move(wl_listener* listener, void* data) {
+        XwaylandToplevel* toplevel =
+            static_cast<wrapper::Listener<XwaylandToplevel>*>(listener)->container;
+        if(mapped(toplevel->xsurface))
+            server.input_manager.seat.cursor.begin_interactive(toplevel, cursor::CursorMode::MOVE,
+                                                               0);
+    }
+
+    void toplevel_request_resize(wl_listener* listener, void* data) {
+        XwaylandToplevel* toplevel =
+            static_cast<wrapper::Listener<XwaylandToplevel>*>(listener)->container;
+        wlr_xwayland_resize_event* event = static_cast<wlr_xwayland_resize_event*>(data);
+        if(mapped(toplevel->xsurface))
+            server.input_manager.seat.cursor.begin_interactive(
+                toplevel, cursor::CursorMode::RESIZE, event->edges);
+    }
+
+    void toplevel_set_title(wl_listener* listener, void* data) {
+        XwaylandToplevel* toplevel =
+            static_cast<wrapper::Listener<XwaylandToplevel>*>(listener)->container;
+        toplevel->handle_title_change();
+    }
+
+    // The X11 class is used as the app_id
+    void toplevel_set_class(wl_listener* listener, void* data) {
+        XwaylandToplevel* toplevel =
+            static_cast<wrapper::Listener<XwaylandToplevel>*>(listener)->container;
+        toplevel->handle_app_id_change();
+    }
+
+    void unmanaged_map(wl_listener* listener, void* data) {
+        Unmanaged* unmanaged = static_cast<wrapper::Listener<Unmanaged>*>(listener)->container;
+
+        unmanaged->scene_tree =
+            wlr_scene_subsurface_tree_create(server.root.unmanaged, unmanaged->xsurface->surface);
+        wlr_scene_node_set_position(&unmanaged->scene_tree->node, unmanaged->xsurface->x,
+                                    unmanaged->xsurface->y);
+    }
+
+    void unmanaged_unmap(wl_listener* listener, void* data) {
+        Unmanaged* unmanaged = static_cast<wrapper::Listener<Unmanaged>*>(listener)->container;
+
+        wlr_scene_node_destroy(&unmanaged->scene_tree->node);
+        unmanaged->scene_tree = nullptr;
+    }
+
+    void unmanaged_associate(wl_listener* listener, void* data) {
+        Unmanaged* unmanaged = static_cast<wrapper::Listener<Unmanaged>*>(listener)->container;
+
+        unmanaged->map.emplace(unmanaged, unmanaged_map,
+                               &unmanaged->xsurface->surface->events.map);
+        unmanaged->unmap.emplace(unmanaged, unmanaged_unmap,
+                                 &unmanaged->xsurface->surface->events.unmap);
+    }
+
+    void unmanaged_dissociate(wl_listener* listener, void* data) {
+        Unmanaged* unmanaged = static_cast<wrapper::Listener<Unmanaged>*>(listener)->container;
+
+        unmanaged->map.reset();
+        unmanaged->unmap.reset();
+    }
+
+    void unmanaged_destroy(wl_listener* listener, void* data) {
+        delete static_cast<wrapper::Listener<Unmanaged>*>(listener)->container;
+    }
+
+    void unmanaged_request_configure(wl_listener* listener, void* data) {
+        Unmanaged* unmanaged = static_cast<wrapper::Listener<Unmanaged>*>(listener)->container;
+        wlr_xwayland_surface_configure_event* event =
+            static_cast<wlr_xwayland_surface_configure_event*>(data);
+
+        wlr_xwayland_surface_configure(unmanaged->xsurface, event->x, event->y, event->width,
+                                       event->height);
+    }
+
+    void unmanaged_set_geometry(wl_listener* listener, void* data) {
+        Unmanaged* unmanaged = static_cast<wrapper::Listener<Unmanaged>*>(listener)->container;
+
+        if(unmanaged->scene_tree)
+            wlr_scene_node_set_position(&unmanaged->scene_tree->node, unmanaged->xsurface->x,
+                                        unmanaged->xsurface->y);
+    }
+
+    Xwayland::Xwayland(wlr_xwayland* xwayland)
+        : xwayland(xwayland),
+
+          ready(this, xwayland::ready, &xwayland->events.ready),
+          new_surface(this, xwayland::new_surface, &xwayland->events.new_surface) {}
+
+    XwaylandToplevel::XwaylandToplevel(wlr_xwayland_surface* xsurface)
+        // The surface only gets added on map, the tree holds the toplevel until then
+        : Toplevel(wlr_scene_tree_create(server.root.floating)),
+          xsurface(xsurface),
+          surface_tree(nullptr),
+
+          destroy(this, toplevel_destroy, &xsurface->events.destroy),
+          associate(this, toplevel_associate, &xsurface->events.associate),
+          dissociate(this, toplevel_dissociate, &xsurface->events.dissociate),
+          request_configure(this, toplevel_request_configure, &xsurface->events.request_configure),
+          request_activate(this, toplevel_request_activate, &xsurface->events.request_activate),
+          request_fullscreen(this, toplevel_request_fullscreen,
+                             &xsurface->events.request_fullscreen),
+          request_move(this, toplevel_request_move, &xsurface->events.request_move),
+          request_resize(this, toplevel_request_resize, &xsurface->events.request_resize),
+          set_title(this, toplevel_set_title, &xsurface->events.set_title),
+          set_class(this, toplevel_set_class, &xsurface->events.set_class) {
+        xsurface->data = this;
+    }
+
+    XwaylandToplevel::~XwaylandToplevel() {
+        // Unlike with xdg toplevels, the tree is ours
+        wlr_scene_node_destroy(&scene_tree->node);
+    }
+
+    wlr_surface* XwaylandToplevel::surface() {
+        return xsurface->surface;
+    }
+
+    wlr_box XwaylandToplevel::geometry() {
+        return { 0, 0, xsurface->width, xsurface->height };
+    }
+
+    const char* XwaylandToplevel::app_id() {
+        // class is renamed by wlr.hpp
+        return xsurface->class_;
+    }
+
+    const char* XwaylandToplevel::title() {
+        return xsurface->title;
+    }
+
+    void XwaylandToplevel::set_size(int width, int height) {
+        wlr_xwayland_surface_configure(xsurface, scene_tree->node.x, scene_tree->node.y, width,
+                                       height);
+    }
+
+    void XwaylandToplevel::set_activated(bool activated) {
+        wlr_xwayland_surface_activate(xsurface, activated);
+        if(activated)
+            wlr_xwayland_surface_restack(xsurface, nullptr, XCB_STACK_MODE_ABOVE);
+    }
+
+    void XwaylandToplevel::set_fullscreen(bool fullscreen) {
+        wlr_xwayland_surface_set_fullscreen(xsurface, fullscreen);
+    }
+
+    void XwaylandToplevel::close() {
+        wlr_xwayland_surface_close(xsurface);
+    }
+
+    wlr_scene_tree* XwaylandToplevel::create_view(wlr_scene_tree* parent) {
+        if(!xsurface->surface)
+            return nullptr;
+        return wlr_scene_subsurface_tree_create(parent, xsurface->surface);
+    }
+
+    void XwaylandToplevel::set_position(int x, int y) {
+        Toplevel::set_position(x, y);
+        wlr_xwayland_surface_configure(xsurface, x, y, xsurface->width, xsurface->height);
+    }
+
+    Unmanaged::Unmanaged(wlr_xwayland_surface* xsurface)
+        : xsurface(xsurface),
+          scene_tree(nullptr),
+
+          destroy(this, unmanaged_destroy, &xsurface->events.destroy),
+          associate(this, unmanaged_associate, &xsurface->events.associate),
+          dissociate(this, unmanaged_dissociate, &xsurface->events.dissociate),
+          request_configure(this, unmanaged_request_configure,
+                            &xsurface->events.request_configure),
+          set_geometry(this, unmanaged_set_geometry, &xsurface->events.set_geometry) {
+        xsurface->data = this;
+    }
+
+    bool start(wl_display* display, wlr_compositor* compositor, bool lazy) {
+        wlr_xwayland* xwayland = wlr_xwayland_create(display, compositor, lazy);
+        if(!xwayland) {
+            wlr_log(WLR_ERROR, "failed to create Xwayland, X11 clients won't be able to run");
+            return false;
+        }
+
+        wlr_xwayland_set_seat(xwayland, server.input_manager.seat.seat);
+        setenv("DISPLAY", xwayland->display_name, true);
+        instance = new Xwayland(xwayland);
+
+        wlr_log(WLR_INFO, "Xwayland %s on DISPLAY=%s", lazy ? "will start on demand" : "starting",
+                xwayland->display_name);
+        return true;
+    }
+
+    void stop() {
+        if(!instance)
+            return;
+
+        // The listeners have to be gone before wlroots destroys the signals
+        wlr_xwayland* xwayland = instance->xwayland;
+        delete instance;
+        instance = nullptr;
+
+        wlr_xwayland_destroy(xwayland);
+    }
+
+    wlr_surface* unmanaged_at(double lx, double ly, double& sx, double& sy) {
+        wlr_scene_node* node = wlr_scene_node_at(&server.root.unmanaged->node, lx, ly, &sx, &sy);
+        if(!node || node->type != WLR_SCENE_NODE_BUFFER)
+            return nullptr;
+
+        wlr_scene_surface* scene_surface =
+            wlr_scene_surface_try_from_buffer(wlr_scene_buffer_from_node(node));
+        return scene_surface ? scene_surface->surface : nullptr;
+    }
+}